@@ -0,0 +1,105 @@
+#pragma once
+#include <stdlib.h>
+#include <string.h>
+#define null 0
+/*
+ *	arena
+ *
+ *	A bump allocator.  Memory is handed out from large blocks and is
+ *	never freed piece by piece: release (or the destructor) frees every
+ *	block at once.  No destructors are run for what is allocated here,
+ *	so an arena should only hold objects that need none.
+ */
+class arena {
+public:
+	arena() {
+		_blocks = null;
+		_next = null;
+		_end = null;
+	}
+
+	~arena() {
+		release();
+	}
+	/*
+	 *	allocate
+	 *
+	 *	RETURNS:
+	 *		'size' bytes, aligned for any scalar type.
+	 */
+	void* allocate(int size) {
+		size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		if (size > _end - _next)
+			return allocateBlock(size);
+		void* p = _next;
+		_next += size;
+		return p;
+	}
+	/*
+	 *	copy
+	 *
+	 *	RETURNS:
+	 *		A null terminated copy of the 'length' bytes at 'text'.
+	 */
+	char* copy(const char* text, int length) {
+		char* cp = (char*)allocate(length + 1);
+		memcpy(cp, text, length);
+		cp[length] = 0;
+		return cp;
+	}
+
+	void release() {
+		while (_blocks != null) {
+			Block* b = _blocks;
+			_blocks = b->next;
+			free(b);
+		}
+		_next = null;
+		_end = null;
+	}
+
+private:
+	static const int ALIGNMENT = 8;
+	static const int BLOCK_SIZE = 64 * 1024;
+
+	struct Block {
+		Block*		next;
+		double		align;			// keeps data() aligned on 32 bit targets
+
+		char* data() { return (char*)(this + 1); }
+	};
+
+	arena(const arena&);
+
+	const arena& operator= (const arena&);
+	/*
+	 *	allocateBlock
+	 *
+	 *	A request for more than a quarter of a block gets a block of its
+	 *	own, kept behind the current one so the space left in that is
+	 *	not wasted.
+	 */
+	void* allocateBlock(int size) {
+		if (size > BLOCK_SIZE / 4) {
+			Block* b = (Block*)malloc(sizeof (Block) + size);
+			if (_blocks != null) {
+				b->next = _blocks->next;
+				_blocks->next = b;
+			} else {
+				b->next = null;
+				_blocks = b;
+			}
+			return b->data();
+		}
+		Block* b = (Block*)malloc(sizeof (Block) + BLOCK_SIZE);
+		b->next = _blocks;
+		_blocks = b;
+		_next = b->data() + size;
+		_end = b->data() + BLOCK_SIZE;
+		return b->data();
+	}
+
+	Block*		_blocks;
+	char*		_next;
+	char*		_end;
+};
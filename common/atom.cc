@@ -41,14 +41,9 @@ int Atom::size() const {
 }
 
 Object::~Object() {
-	dictionary<Atom*>::iterator i = _properties.begin();
-
-	while (i.hasNext()) {
-		string s = i.key();
-		if (s != "parent")
-			delete *i;
-		i.next();
-	}
+	for (int i = 0; i < _properties.size(); i++)
+		if (_properties[i].name != "parent")
+			delete _properties[i].value;
 }
 
 bool Object::isRunnable() const {
@@ -57,27 +52,25 @@ bool Object::isRunnable() const {
 
 string Object::toSource() {
 	string s;
-	dictionary<Atom*>::iterator i = _properties.begin();
 
 	bool firstTime = true;
 	script::Atom* a = get("tag");
 	if (a != null)
 		s.append(a->toString());
 	s.push_back('(');
-	while (i.hasNext()) {
-		if (i.key() != "tag" &&
-			i.key() != "content" &&
-			i.key() != "parent") {
-			script::Atom* a = *i;
+	for (int i = 0; i < _properties.size(); i++) {
+		const Property& p = _properties[i];
+		if (p.name != "tag" &&
+			p.name != "content" &&
+			p.name != "parent") {
 			if (firstTime)
 				firstTime = false;
 			else
 				s.push_back(',');
-			s.append(i.key());
+			s.append(p.name);
 			s.push_back(':');
-			s.append(a->toSource());
+			s.append(p.value->toSource());
 		}
-		i.next();
 	}
 	s.push_back(')');
 	a = get("content");
@@ -98,11 +91,27 @@ string Object::toString() {
 }
 
 Atom* Object::get(const string& name) const {
-	return *_properties.get(name);
+	Symbol s;
+	if (!Symbol::find(name, &s))
+		return null;
+	int i = indexOf(s);
+	if (i < 0)
+		return null;
+	else
+		return _properties[i].value;
 }
 
 bool Object::put(const string& name, Atom* value) {
-	Atom* a = _properties.replace(name, value);
+	Symbol s(name);
+	int i = indexOf(s);
+	if (i < 0) {
+		Property& p = _properties.emplace_back();
+		p.name = s;
+		p.value = value;
+		return true;
+	}
+	Atom* a = _properties[i].value;
+	_properties[i].value = value;
 	if (a) {
 		delete a;
 		return false;
@@ -110,6 +119,13 @@ bool Object::put(const string& name, Atom* value) {
 		return true;
 }
 
+int Object::indexOf(Symbol name) const {
+	for (int i = 0; i < _properties.size(); i++)
+		if (_properties[i].name == name)
+			return i;
+	return -1;
+}
+
 bool Object::runAnyContent() {
 	script::Atom* c = get("content");
 	if (c != null) {
@@ -160,7 +176,7 @@ String::String(const string& s) {
 string String::toSource() {
 	string s;
 	s.push_back('"');
-	s = s + _content.escapeC();
+	s.append(_content.escapeC());
 	s.push_back('"');
 	return s;
 }
@@ -1,7 +1,7 @@
 #pragma once
 #include <typeinfo.h>
-#include "dictionary.h"
 #include "string.h"
+#include "symbol.h"
 #include "vector.h"
 
 namespace script {
@@ -72,7 +72,18 @@ public:
 	bool runAllContent();
 
 private:
-	dictionary<Atom*>	_properties;
+	/*
+	 *	Objects carry a handful of properties, so they are kept in
+	 *	definition order and found by comparing interned names.
+	 */
+	struct Property {
+		Symbol		name;
+		Atom*		value;
+	};
+
+	int indexOf(Symbol name) const;
+
+	vector<Property>	_properties;
 };
 
 class TextRun : public Atom {
@@ -125,7 +136,7 @@ public:
 	const vector<Atom*>& value() const { return _value; }
 
 private:
-	vector<Atom*>		_value;
+	smallVector<Atom*, 4>	_value;
 };
 
 }  // namespace script
@@ -0,0 +1,193 @@
+#pragma once
+#include <stdlib.h>
+#include <string.h>
+#include "map.h"
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BIT_VECTOR_SSE2
+#endif
+#define null 0
+/*
+ *	bitVector
+ *
+ *	A dense set of small non-negative integers, one bit per possible
+ *	member.  Membership is a shift and a mask, count and findFirst skip
+ *	a 32 bit word at a time, and union and intersection combine 128
+ *	bits at a time with SSE2.
+ *
+ *	Storage is always a whole number of 128 bit blocks, and bits past
+ *	size() are always zero.
+ */
+class bitVector {
+public:
+	bitVector() {
+		_words = null;
+		_size = 0;
+		_allocatedWords = 0;
+	}
+
+	explicit bitVector(int size) {
+		_words = null;
+		_size = 0;
+		_allocatedWords = 0;
+		resize(size);
+	}
+
+	bitVector(const bitVector& source) {
+		_words = null;
+		_size = 0;
+		_allocatedWords = 0;
+		*this = source;
+	}
+
+	~bitVector() {
+		free(_words);
+	}
+
+	bitVector& operator= (const bitVector& source) {
+		if (this != &source) {
+			resize(0);
+			resize(source._size);
+			if (_size)
+				memcpy(_words, source._words, ((_size + 31) >> 5) * sizeof (unsigned));
+		}
+		return *this;
+	}
+	/*
+	 *	resize
+	 *
+	 *	Makes the vector hold 'size' bits.  Bits added are zero.
+	 */
+	void resize(int size) {
+		int words = (size + BLOCK_BITS - 1) / BLOCK_BITS * BLOCK_WORDS;
+		if (words > _allocatedWords) {
+			_words = (unsigned*)realloc(_words, words * sizeof (unsigned));
+			memset(_words + _allocatedWords, 0, (words - _allocatedWords) * sizeof (unsigned));
+			_allocatedWords = words;
+		}
+		if (size < _size) {
+			// Clear the dropped bits so that a later resize brings back zeroes
+			int w = size >> 5;
+			if (size & 31)
+				_words[w++] &= (1u << (size & 31)) - 1;
+			memset(_words + w, 0, (_allocatedWords - w) * sizeof (unsigned));
+		}
+		_size = size;
+	}
+
+	int size() const { return _size; }
+
+	bool test(int i) const {
+		return (_words[i >> 5] >> (i & 31)) & 1;
+	}
+
+	bool operator [] (int i) const {
+		return test(i);
+	}
+
+	void set(int i) {
+		_words[i >> 5] |= 1u << (i & 31);
+	}
+
+	void reset(int i) {
+		_words[i >> 5] &= ~(1u << (i & 31));
+	}
+
+	void clear() {
+		if (_allocatedWords)
+			memset(_words, 0, _allocatedWords * sizeof (unsigned));
+	}
+	/*
+	 *	count
+	 *
+	 *	RETURNS:
+	 *		The number of bits that are set.
+	 */
+	int count() const {
+		int n = 0;
+		for (int i = 0; i < _allocatedWords; i++)
+			n += popCount(_words[i]);
+		return n;
+	}
+	/*
+	 *	findFirst
+	 *
+	 *	RETURNS:
+	 *		The index of the first set bit at or after 'start', or -1
+	 *		if there is none.
+	 */
+	int findFirst(int start = 0) const {
+		if (start >= _size)
+			return -1;
+		int w = start >> 5;
+		unsigned bits = _words[w] & (~0u << (start & 31));
+		for (;;) {
+			if (bits)
+				return (w << 5) + hashTable::lowestBit(bits);
+			if (++w >= _allocatedWords)
+				return -1;
+			bits = _words[w];
+		}
+	}
+	/*
+	 *	unionWith
+	 *
+	 *	Sets every bit that is set in 'other'.  Grows this vector if
+	 *	'other' is larger.
+	 */
+	void unionWith(const bitVector& other) {
+		if (other._size > _size)
+			resize(other._size);
+		// Words of 'other' past this vector's storage are all zero
+		int common = _allocatedWords < other._allocatedWords ? _allocatedWords : other._allocatedWords;
+		int i = 0;
+#ifdef BIT_VECTOR_SSE2
+		for (; i < common; i += BLOCK_WORDS) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(_words + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(other._words + i));
+			_mm_storeu_si128((__m128i*)(_words + i), _mm_or_si128(a, b));
+		}
+#endif
+		for (; i < common; i++)
+			_words[i] |= other._words[i];
+	}
+	/*
+	 *	intersectWith
+	 *
+	 *	Clears every bit that is not set in 'other'.
+	 */
+	void intersectWith(const bitVector& other) {
+		int common = _allocatedWords < other._allocatedWords ? _allocatedWords : other._allocatedWords;
+		int i = 0;
+#ifdef BIT_VECTOR_SSE2
+		for (; i < common; i += BLOCK_WORDS) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(_words + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(other._words + i));
+			_mm_storeu_si128((__m128i*)(_words + i), _mm_and_si128(a, b));
+		}
+#endif
+		for (; i < common; i++)
+			_words[i] &= other._words[i];
+		if (common < _allocatedWords)
+			memset(_words + common, 0, (_allocatedWords - common) * sizeof (unsigned));
+	}
+
+private:
+	static const int BLOCK_BITS = 128;
+	static const int BLOCK_WORDS = BLOCK_BITS / 32;
+
+	static int popCount(unsigned x) {
+#if defined(__GNUC__)
+		return __builtin_popcount(x);
+#else
+		x = x - ((x >> 1) & 0x55555555);
+		x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+		x = (x + (x >> 4)) & 0x0f0f0f0f;
+		return (x * 0x01010101) >> 24;
+#endif
+	}
+
+	unsigned*	_words;
+	int			_size;				// in bits
+	int			_allocatedWords;	// always a multiple of BLOCK_WORDS
+};
@@ -0,0 +1,463 @@
+#pragma once
+#define null 0
+/*
+ *	btree
+ *
+ *	An ordered set kept as a B+-tree.  Elements are ordered by their
+ *	compare method and no two elements of the tree compare equal.
+ *
+ *	Elements live only in the leaves, which hold up to NODE_SIZE of them
+ *	in a plain array and are chained left to right, so a range is read
+ *	by finding its first element and walking the chain.  Branches hold
+ *	up to NODE_SIZE children and, between each pair, a copy of the
+ *	first element of the right child.  With the default NODE_SIZE a
+ *	tree of a million elements is four levels deep, and each level is
+ *	searched within a few contiguous cache lines.
+ *
+ *	Searches take a key object whose compare method orders the key
+ *	against an element, as for binarySearch.
+ *
+ *	Erasing an element that leaves a node less than half full either
+ *	moves an entry over from a neighbour or merges the two nodes.
+ *
+ *	Elements must be default constructible and assignable.  A tree
+ *	cannot be copied.
+ */
+template<class A, int NODE_SIZE = 32>
+class btree {
+	struct Leaf;
+public:
+	btree() {
+		_root = null;
+		_first = null;
+		_size = 0;
+	}
+
+	~btree() {
+		clear();
+	}
+
+	class iterator {
+		friend btree;
+	public:
+		bool valid() {
+			return _leaf != null;
+		}
+
+		void next() {
+			_index++;
+			settle();
+		}
+
+		const A& operator* () {
+			return _leaf->elements[_index];
+		}
+
+		const A* operator-> () {
+			return &_leaf->elements[_index];
+		}
+
+	private:
+		iterator(Leaf* leaf, int index) {
+			_leaf = leaf;
+			_index = index;
+			settle();
+		}
+
+		void settle() {
+			while (_leaf != null && _index >= _leaf->count) {
+				_leaf = _leaf->next;
+				_index = 0;
+			}
+		}
+
+		Leaf*	_leaf;
+		int		_index;
+	};
+
+	iterator begin() const {
+		return iterator(_first, 0);
+	}
+	/*
+	 *	insert
+	 *
+	 *	Adds 'a' to the tree, unless an element equal to it is already
+	 *	there.
+	 *
+	 *	RETURNS:
+	 *		true - if 'a' was added.
+	 *		false - an equal element was already present, no change.
+	 */
+	bool insert(const A& a) {
+		if (_root == null) {
+			Leaf* leaf = new Leaf;
+			leaf->count = 0;
+			leaf->next = null;
+			_root = leaf;
+			_first = leaf;
+		}
+		Node* split = null;
+		A separator;
+		if (!insertInto(_root, a, &split, &separator))
+			return false;
+		if (split != null) {
+			Branch* b = new Branch;
+			b->isLeaf = false;
+			b->count = 2;
+			b->children[0] = _root;
+			b->children[1] = split;
+			b->keys[0] = separator;
+			_root = b;
+		}
+		_size++;
+		return true;
+	}
+	/*
+	 *	erase
+	 *
+	 *	Removes the element equal to 'key', if there is one.
+	 *
+	 *	RETURNS:
+	 *		true - if an element was removed.
+	 *		false - there was no such element, no change.
+	 */
+	template<class Key>
+	bool erase(const Key& key) {
+		if (_root == null || !eraseFrom(_root, key))
+			return false;
+		_size--;
+		if (_root->isLeaf) {
+			if (_root->count == 0) {
+				delete (Leaf*)_root;
+				_root = null;
+				_first = null;
+			}
+		} else if (_root->count == 1) {
+			Branch* b = (Branch*)_root;
+			_root = b->children[0];
+			delete b;
+		}
+		return true;
+	}
+	/*
+	 *	lowerBound
+	 *
+	 *	RETURNS:
+	 *		An iterator at the first element not less than 'key'.
+	 */
+	template<class Key>
+	iterator lowerBound(const Key& key) const {
+		Leaf* leaf = findLeaf(key);
+		if (leaf == null)
+			return iterator(null, 0);
+		int i = 0;
+		while (i < leaf->count && key.compare(leaf->elements[i]) > 0)
+			i++;
+		return iterator(leaf, i);
+	}
+	/*
+	 *	upperBound
+	 *
+	 *	RETURNS:
+	 *		An iterator at the first element greater than 'key'.
+	 */
+	template<class Key>
+	iterator upperBound(const Key& key) const {
+		Leaf* leaf = findLeaf(key);
+		if (leaf == null)
+			return iterator(null, 0);
+		int i = 0;
+		while (i < leaf->count && key.compare(leaf->elements[i]) >= 0)
+			i++;
+		return iterator(leaf, i);
+	}
+	/*
+	 *	find
+	 *
+	 *	RETURNS:
+	 *		A pointer to the element equal to 'key', or null if there
+	 *		is none.
+	 */
+	template<class Key>
+	const A* find(const Key& key) const {
+		iterator i = lowerBound(key);
+		if (i.valid() && key.compare(*i) == 0)
+			return &*i;
+		else
+			return null;
+	}
+
+	void clear() {
+		if (_root != null)
+			deleteNode(_root);
+		_root = null;
+		_first = null;
+		_size = 0;
+	}
+
+	int size() const { return _size; }
+
+private:
+	static const int MIN_COUNT = NODE_SIZE / 2;	// fewest entries in any node but the root
+
+	struct Node {
+		bool		isLeaf;
+		int			count;			// elements in a leaf, children in a branch
+	};
+	/*
+	 *	Both kinds of node have room for one entry more than NODE_SIZE,
+	 *	so an insert can go in first and the node split after.
+	 */
+	struct Leaf : Node {
+		Leaf() {
+			this->isLeaf = true;
+		}
+
+		Leaf*		next;
+		A			elements[NODE_SIZE + 1];
+	};
+
+	struct Branch : Node {
+		Node*		children[NODE_SIZE + 1];
+		A			keys[NODE_SIZE];		// keys[i] is the first element under children[i + 1]
+	};
+	/*
+	 *	childIndex
+	 *
+	 *	RETURNS:
+	 *		The child of 'b' that would hold 'key': the number of
+	 *		separators no greater than the key.
+	 */
+	template<class Key>
+	static int childIndex(const Branch* b, const Key& key) {
+		int min = 0;
+		int max = b->count - 1;
+		while (min < max) {
+			int mid = (min + max) >> 1;
+			if (key.compare(b->keys[mid]) >= 0)
+				min = mid + 1;
+			else
+				max = mid;
+		}
+		return min;
+	}
+
+	template<class Key>
+	Leaf* findLeaf(const Key& key) const {
+		Node* n = _root;
+		if (n == null)
+			return null;
+		while (!n->isLeaf) {
+			Branch* b = (Branch*)n;
+			n = b->children[childIndex(b, key)];
+		}
+		return (Leaf*)n;
+	}
+	/*
+	 *	insertInto
+	 *
+	 *	Inserts 'a' into the subtree at 'n'.  If 'n' had to split, the
+	 *	new right half is stored in *split and the first element under
+	 *	it in *separator.
+	 *
+	 *	RETURNS:
+	 *		false if an equal element was found, true otherwise.
+	 */
+	bool insertInto(Node* n, const A& a, Node** split, A* separator) {
+		if (n->isLeaf) {
+			Leaf* leaf = (Leaf*)n;
+			int i = 0;
+			int relation = 1;
+			while (i < leaf->count && (relation = a.compare(leaf->elements[i])) > 0)
+				i++;
+			if (i < leaf->count && relation == 0)
+				return false;
+			for (int j = leaf->count; j > i; j--)
+				leaf->elements[j] = static_cast<A&&>(leaf->elements[j - 1]);
+			leaf->elements[i] = a;
+			leaf->count++;
+			if (leaf->count > NODE_SIZE) {
+				Leaf* right = new Leaf;
+				int half = leaf->count >> 1;
+				right->count = leaf->count - half;
+				for (int j = 0; j < right->count; j++)
+					right->elements[j] = static_cast<A&&>(leaf->elements[half + j]);
+				leaf->count = half;
+				right->next = leaf->next;
+				leaf->next = right;
+				*separator = right->elements[0];
+				*split = right;
+			}
+			return true;
+		}
+		Branch* b = (Branch*)n;
+		int i = childIndex(b, a);
+		Node* childSplit = null;
+		A childSeparator;
+		if (!insertInto(b->children[i], a, &childSplit, &childSeparator))
+			return false;
+		if (childSplit == null)
+			return true;
+		for (int j = b->count; j > i + 1; j--) {
+			b->children[j] = b->children[j - 1];
+			b->keys[j - 1] = static_cast<A&&>(b->keys[j - 2]);
+		}
+		b->children[i + 1] = childSplit;
+		b->keys[i] = static_cast<A&&>(childSeparator);
+		b->count++;
+		if (b->count > NODE_SIZE) {
+			Branch* right = new Branch;
+			right->isLeaf = false;
+			int half = b->count >> 1;
+			right->count = b->count - half;
+			for (int j = 0; j < right->count; j++)
+				right->children[j] = b->children[half + j];
+			for (int j = 0; j < right->count - 1; j++)
+				right->keys[j] = static_cast<A&&>(b->keys[half + j]);
+			*separator = static_cast<A&&>(b->keys[half - 1]);
+			b->count = half;
+			*split = right;
+		}
+		return true;
+	}
+
+	/*
+	 *	eraseFrom
+	 *
+	 *	Removes the element equal to 'key' from the subtree at 'n', and
+	 *	rebalances any child that is left less than half full.  The
+	 *	separators above a removed first element are left as they
+	 *	are: they still divide the children correctly.
+	 *
+	 *	RETURNS:
+	 *		false if there was no such element, true otherwise.
+	 */
+	template<class Key>
+	bool eraseFrom(Node* n, const Key& key) {
+		if (n->isLeaf) {
+			Leaf* leaf = (Leaf*)n;
+			int i = 0;
+			while (i < leaf->count && key.compare(leaf->elements[i]) > 0)
+				i++;
+			if (i >= leaf->count || key.compare(leaf->elements[i]) != 0)
+				return false;
+			leaf->count--;
+			for (int j = i; j < leaf->count; j++)
+				leaf->elements[j] = static_cast<A&&>(leaf->elements[j + 1]);
+			leaf->elements[leaf->count] = A();
+			return true;
+		}
+		Branch* b = (Branch*)n;
+		int i = childIndex(b, key);
+		if (!eraseFrom(b->children[i], key))
+			return false;
+		if (b->children[i]->count < MIN_COUNT)
+			rebalance(b, i > 0 ? i - 1 : i);
+		return true;
+	}
+	/*
+	 *	rebalance
+	 *
+	 *	Children i and i + 1 of 'b' are neighbours, and one of them has
+	 *	fallen below MIN_COUNT.  If both fit in one node, the right one
+	 *	is merged into the left, otherwise an entry is moved across to
+	 *	the smaller and keys[i] updated.
+	 */
+	static void rebalance(Branch* b, int i) {
+		Node* left = b->children[i];
+		Node* right = b->children[i + 1];
+		if (left->count + right->count <= NODE_SIZE) {
+			if (left->isLeaf)
+				mergeLeaves((Leaf*)left, (Leaf*)right);
+			else
+				mergeBranches((Branch*)left, (Branch*)right, b->keys[i]);
+			for (int j = i + 1; j < b->count - 1; j++) {
+				b->children[j] = b->children[j + 1];
+				b->keys[j - 1] = static_cast<A&&>(b->keys[j]);
+			}
+			b->count--;
+			b->keys[b->count - 1] = A();
+		} else if (left->isLeaf) {
+			Leaf* l = (Leaf*)left;
+			Leaf* r = (Leaf*)right;
+			if (l->count < r->count) {
+				l->elements[l->count++] = static_cast<A&&>(r->elements[0]);
+				r->count--;
+				for (int j = 0; j < r->count; j++)
+					r->elements[j] = static_cast<A&&>(r->elements[j + 1]);
+			} else {
+				for (int j = r->count; j > 0; j--)
+					r->elements[j] = static_cast<A&&>(r->elements[j - 1]);
+				r->elements[0] = static_cast<A&&>(l->elements[--l->count]);
+				r->count++;
+			}
+			b->keys[i] = r->elements[0];
+		} else {
+			Branch* l = (Branch*)left;
+			Branch* r = (Branch*)right;
+			if (l->count < r->count) {
+				l->children[l->count] = r->children[0];
+				l->keys[l->count - 1] = static_cast<A&&>(b->keys[i]);
+				l->count++;
+				b->keys[i] = static_cast<A&&>(r->keys[0]);
+				r->count--;
+				for (int j = 0; j < r->count; j++)
+					r->children[j] = r->children[j + 1];
+				for (int j = 0; j < r->count - 1; j++)
+					r->keys[j] = static_cast<A&&>(r->keys[j + 1]);
+			} else {
+				for (int j = r->count; j > 0; j--)
+					r->children[j] = r->children[j - 1];
+				for (int j = r->count - 1; j > 0; j--)
+					r->keys[j] = static_cast<A&&>(r->keys[j - 1]);
+				r->children[0] = l->children[l->count - 1];
+				r->keys[0] = static_cast<A&&>(b->keys[i]);
+				r->count++;
+				b->keys[i] = static_cast<A&&>(l->keys[l->count - 2]);
+				l->count--;
+			}
+		}
+	}
+
+	static void mergeLeaves(Leaf* left, Leaf* right) {
+		for (int j = 0; j < right->count; j++)
+			left->elements[left->count + j] = static_cast<A&&>(right->elements[j]);
+		left->count += right->count;
+		left->next = right->next;
+		delete right;
+	}
+	/*
+	 *	mergeBranches
+	 *
+	 *	The separator between the two branches becomes the key between
+	 *	the last child of 'left' and the first of 'right'.
+	 */
+	static void mergeBranches(Branch* left, Branch* right, const A& separator) {
+		left->keys[left->count - 1] = separator;
+		for (int j = 0; j < right->count; j++)
+			left->children[left->count + j] = right->children[j];
+		for (int j = 0; j < right->count - 1; j++)
+			left->keys[left->count + j] = static_cast<A&&>(right->keys[j]);
+		left->count += right->count;
+		delete right;
+	}
+
+	static void deleteNode(Node* n) {
+		if (n->isLeaf)
+			delete (Leaf*)n;
+		else {
+			Branch* b = (Branch*)n;
+			for (int i = 0; i < b->count; i++)
+				deleteNode(b->children[i]);
+			delete b;
+		}
+	}
+
+	btree(const btree&);
+
+	const btree& operator= (const btree&);
+
+	Node*		_root;
+	Leaf*		_first;
+	int			_size;
+};
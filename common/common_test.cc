@@ -2,9 +2,17 @@
 #include "function.h"
 
 #include "atom.h"
+#include "bit_vector.h"
+#include "btree.h"
+#include "dictionary.h"
+#include "file_system.h"
+#include "map.h"
+#include "parallel_sort.h"
 #include "parser.h"
 #include "hill_climb.h"
 #include "random.h"
+#include "search_index.h"
+#include "xml.h"
 
 class FunctionObject : script::Object {
 public:
@@ -411,6 +419,1660 @@ public:
 	};
 };
 
+/*
+ *	ParallelSortObject
+ *
+ *	Sorts random vectors with process::parallelSort on pools of one to
+ *	'threads' threads (default 4) and compares them with the same
+ *	vectors sorted serially.  The sizes run from below the parallel
+ *	threshold up to 'count' elements (default 200000), and the keys
+ *	repeat, so runs and merges meet equal elements.
+ */
+class ParallelSortObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new ParallelSortObject();
+	}
+
+	ParallelSortObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		int count = 200000;
+		int threads = 4;
+		Atom* a = get("count");
+		if (a)
+			count = a->toString().toInt();
+		a = get("threads");
+		if (a)
+			threads = a->toString().toInt();
+		random::Random r(12345);
+		for (int t = 1; t <= threads; t++) {
+			process::ThreadPool pool(t);
+			for (int n = process::PARALLEL_SORT_THRESHOLD - 1; n <= count; n = n * 3 + 1) {
+				vector<Item> items;
+				for (int i = 0; i < n; i++) {
+					Item& x = items.emplace_back();
+					x.key = r.next() % (n / 4 + 1);
+					x.position = i;
+				}
+				vector<Item> serial(items);
+				serial.sort(compare);
+				process::parallelSort(&pool, &items, compare);
+				if (!check(items, serial, t))
+					return false;
+			}
+		}
+		return runAnyContent();
+	}
+
+private:
+	struct Item {
+		unsigned	key;
+		int			position;			// in the unsorted vector
+	};
+
+	static int compare(const Item& x, const Item& y) {
+		if (x.key < y.key)
+			return -1;
+		else if (x.key > y.key)
+			return 1;
+		else
+			return 0;
+	}
+	/*
+	 *	check
+	 *
+	 *	The sort is not stable, so equal keys may come out in any
+	 *	order, but every element must come out exactly once.
+	 */
+	bool check(const vector<Item>& sorted, const vector<Item>& serial, int threads) {
+		vector<bool> seen;
+		seen.resize(sorted.size());
+		seen.setAll(false);
+		for (int i = 0; i < sorted.size(); i++) {
+			if (sorted[i].key != serial[i].key) {
+				printf("%d threads, %d elements: key %u at %d, expected %u\n", threads, sorted.size(),
+					sorted[i].key, i, serial[i].key);
+				return false;
+			}
+			if (seen[sorted[i].position]) {
+				printf("%d threads, %d elements: element %d appears twice\n", threads, sorted.size(), sorted[i].position);
+				return false;
+			}
+			seen[sorted[i].position] = true;
+		}
+		return true;
+	}
+};
+
+/*
+ *	SearchIndexObject
+ *
+ *	Checks searchIndex lookups against a linear search of the sorted
+ *	keys, which repeat, and checks that copies of an index answer the
+ *	same after the original is gone.  The 'count' property sets the
+ *	number of keys (default 1000).
+ */
+class SearchIndexObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new SearchIndexObject();
+	}
+
+	SearchIndexObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		int count = 1000;
+		Atom* a = get("count");
+		if (a)
+			count = a->toString().toInt();
+		for (int i = 0; i < count; i++)
+			_sorted.push_back(i / 3);
+		searchIndex<double>* index = new searchIndex<double>();
+		index->build(_sorted);
+		if (!check(*index, "built"))
+			return false;
+		searchIndex<double> copy(*index);
+		searchIndex<double> assigned;
+		assigned.build(_sorted);
+		assigned = *index;
+		delete index;
+		if (!check(copy, "copied") || !check(assigned, "assigned"))
+			return false;
+		assigned = assigned;
+		copy = searchIndex<double>();
+		if (!check(assigned, "assigned to itself") || copy.size() != 0)
+			return false;
+		return runAnyContent();
+	}
+
+private:
+	bool check(const searchIndex<double>& index, const char* what) {
+		if (index.size() != _sorted.size()) {
+			printf("%s index has size %d, expected %d\n", what, index.size(), _sorted.size());
+			return false;
+		}
+		vector<double> keys;
+		for (double key = -1; key <= _sorted.size() / 3 + 1; key += 0.5)
+			keys.push_back(key);
+		vector<int> batch(keys.size());
+		index.lowerBound(&keys[0], keys.size(), &batch[0]);
+		for (int i = 0; i < keys.size(); i++) {
+			double key = keys[i];
+			int lower = 0;
+			while (lower < _sorted.size() && _sorted[lower] < key)
+				lower++;
+			int upper = lower;
+			while (upper < _sorted.size() && !(key < _sorted[upper]))
+				upper++;
+			if (index.lowerBound(key) != lower || batch[i] != lower || index.upperBound(key) != upper) {
+				printf("%s index: key %g lowerBound %d batch %d upperBound %d, expected %d and %d\n", what, key,
+					index.lowerBound(key), batch[i], index.upperBound(key), lower, upper);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	vector<double>	_sorted;
+};
+
+/*
+ *	BtreeObject
+ *
+ *	Inserts the even numbers below 2 * 'count' (default 1000) into
+ *	btrees of small and default sized nodes in a scrambled order, then
+ *	erases them again, half and then the rest, checking the ordered
+ *	walk and the searches against a table of which keys are present as
+ *	nodes split and merge.
+ */
+class BtreeObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new BtreeObject();
+	}
+
+	BtreeObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		int count = 1000;
+		Atom* a = get("count");
+		if (a)
+			count = a->toString().toInt();
+		btree<Key, 4>* small = new btree<Key, 4>();
+		btree<Key>* wide = new btree<Key>();
+		bool result = exercise(small, count, "4") && exercise(wide, count, "32");
+		delete small;
+		delete wide;
+		if (!result)
+			return false;
+		return runAnyContent();
+	}
+
+private:
+	class Key {
+	public:
+		Key() {
+			value = -1;
+		}
+
+		Key(int v) {
+			value = v;
+		}
+
+		int compare(const Key& k) const {
+			return value - k.value;
+		}
+
+		int		value;
+	};
+
+	template<int N>
+	bool exercise(btree<Key, N>* t, int count, const char* what) {
+		vector<int> order;
+		for (int i = 0; i < count; i++)
+			order.push_back((int)((i * 7919LL) % count));
+		_present.clear();
+		_present.resize(count);
+		for (int i = 0; i < count; i++)
+			_present[i] = false;
+		for (int i = 0; i < count; i++) {
+			int k = 2 * order[i];
+			if (!t->insert(Key(k))) {
+				printf("btree<%s>: insert of %d failed\n", what, k);
+				return false;
+			}
+			_present[order[i]] = true;
+			if (t->insert(Key(k))) {
+				printf("btree<%s>: second insert of %d succeeded\n", what, k);
+				return false;
+			}
+			if (i % 97 == 0 && !check(t, "insert", what))
+				return false;
+		}
+		if (!check(t, "insert", what))
+			return false;
+		for (int pass = 0; pass < 2; pass++) {
+			for (int i = 0; i < count; i++) {
+				if ((order[i] & 1) != pass)
+					continue;
+				int k = 2 * order[i];
+				if (!t->erase(Key(k))) {
+					printf("btree<%s>: erase of %d failed\n", what, k);
+					return false;
+				}
+				_present[order[i]] = false;
+				if (t->erase(Key(k)) || t->erase(Key(k + 1))) {
+					printf("btree<%s>: erase of missing %d or %d succeeded\n", what, k, k + 1);
+					return false;
+				}
+				if (i % 97 == 0 && !check(t, "erase", what))
+					return false;
+			}
+			if (!check(t, "erase", what))
+				return false;
+		}
+		if (t->begin().valid()) {
+			printf("btree<%s>: not empty after erasing everything\n", what);
+			return false;
+		}
+		return true;
+	}
+
+	template<int N>
+	bool check(btree<Key, N>* t, const char* phase, const char* what) {
+		int expected = 0;
+		typename btree<Key, N>::iterator i = t->begin();
+		for (int k = 0; k < _present.size(); k++) {
+			if (!_present[k])
+				continue;
+			expected++;
+			if (!i.valid() || i->value != 2 * k) {
+				printf("btree<%s> after %s: walk found %d, expected %d\n", what, phase, i.valid() ? i->value : -1, 2 * k);
+				return false;
+			}
+			i.next();
+		}
+		if (i.valid() || t->size() != expected) {
+			printf("btree<%s> after %s: size %d, expected %d\n", what, phase, t->size(), expected);
+			return false;
+		}
+		for (int k = -1; k <= 2 * _present.size(); k++) {
+			int lower = k < 0 ? 0 : (k + 1) / 2;
+			while (lower < _present.size() && !_present[lower])
+				lower++;
+			int upper = k < 0 ? 0 : k / 2 + 1;
+			while (upper < _present.size() && !_present[upper])
+				upper++;
+			typename btree<Key, N>::iterator l = t->lowerBound(Key(k));
+			typename btree<Key, N>::iterator u = t->upperBound(Key(k));
+			const Key* f = t->find(Key(k));
+			bool found = k >= 0 && k < 2 * _present.size() && (k & 1) == 0 && _present[k / 2];
+			if ((l.valid() ? l->value : -1) != (lower < _present.size() ? 2 * lower : -1) ||
+				(u.valid() ? u->value : -1) != (upper < _present.size() ? 2 * upper : -1) ||
+				(f != null) != found || (found && f->value != k)) {
+				printf("btree<%s> after %s: searches for %d are wrong\n", what, phase, k);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	vector<bool>	_present;
+};
+
+/*
+ *	MapObject
+ *
+ *	Exercises map<A, B> erase: reinserting into the slots that erase
+ *	left behind, rebuilding a table full of tombstones at the same
+ *	size and iterating over a map with holes in it.  The 'count'
+ *	property sets the number of keys (default 1000).
+ */
+class MapObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new MapObject();
+	}
+
+	MapObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		int count = 1000;
+		Atom* a = get("count");
+		if (a)
+			count = a->toString().toInt();
+		if (count < 2) {
+			printf("count must be at least 2\n");
+			return false;
+		}
+		_keys.resize(2 * count);
+		for (int i = 0; i < _keys.size(); i++)
+			_keys[i] = i;
+
+		map<int, int> m;
+		for (int i = 0; i < count; i++)
+			m.insert(&_keys[i], i);
+		if (!check(m, 0, count, 1, "after insert"))
+			return false;
+
+			// Erase every other key, then put them back.
+
+		for (int i = 0; i < count; i += 2) {
+			if (!m.erase(&_keys[i])) {
+				printf("erase of key %d failed\n", i);
+				return false;
+			}
+		}
+		if (m.erase(&_keys[0])) {
+			printf("Second erase of key 0 succeeded\n");
+			return false;
+		}
+		if (m.size() != count / 2) {
+			printf("After erase size is %d, expected %d\n", m.size(), count / 2);
+			return false;
+		}
+		if (!check(m, 1, count, 2, "after erase"))
+			return false;
+		for (int i = 0; i < count; i += 2) {
+			if (m.probe(&_keys[i])) {
+				printf("Erased key %d still present\n", i);
+				return false;
+			}
+			if (*m.get(&_keys[i]) != 0) {
+				printf("Erased key %d has value %d\n", i, *m.get(&_keys[i]));
+				return false;
+			}
+		}
+		if (!checkIteration(m, 1, count, 2, "after erase"))
+			return false;
+		int capacity = m.capacity();
+		for (int i = 0; i < count; i += 2) {
+			if (!m.insert(&_keys[i], i)) {
+				printf("Reinsert of key %d failed\n", i);
+				return false;
+			}
+		}
+		if (m.capacity() != capacity) {
+			printf("Reinsert grew the table from %d to %d\n", capacity, m.capacity());
+			return false;
+		}
+		if (!check(m, 0, count, 1, "after reinsert"))
+			return false;
+		if (!checkIteration(m, 0, count, 1, "after reinsert"))
+			return false;
+
+			// Slide a window of count / 2 live keys across all of the
+			// keys.  Every step erases one key and inserts a new one.
+
+		m.clear();
+		int window = count / 2;
+		for (int i = 0; i < window; i++)
+			m.insert(&_keys[i], i);
+		for (int i = window; i < _keys.size(); i++) {
+			m.erase(&_keys[i - window]);
+			m.insert(&_keys[i], i);
+			if (m.size() != window) {
+				printf("Sliding window size is %d at step %d, expected %d\n", m.size(), i, window);
+				return false;
+			}
+		}
+		int first = _keys.size() - window;
+		if (!check(m, first, _keys.size(), 1, "after sliding window"))
+			return false;
+		for (int i = 0; i < first; i++) {
+			if (m.probe(&_keys[i])) {
+				printf("Key %d left behind by sliding window\n", i);
+				return false;
+			}
+		}
+		if (!checkIteration(m, first, _keys.size(), 1, "after sliding window"))
+			return false;
+		m.shrink_to_fit();
+		if (!check(m, first, _keys.size(), 1, "after shrink_to_fit"))
+			return false;
+		if (!checkTombstones())
+			return false;
+		return runAnyContent();
+	}
+
+private:
+	/*
+	 *	checkTombstones
+	 *
+	 *	Builds a table of two groups that is at its growth limit (7/8
+	 *	full) with the first group entirely full, then erases all of the
+	 *	first group's keys.  Those slots become tombstones, since their
+	 *	group has no EMPTY slot.  The next insert that lands on an EMPTY
+	 *	slot finds no growth left, and with fewer than half of the limit
+	 *	in use the table must be rebuilt at its own size.
+	 */
+	bool checkTombstones() {
+		const int GROUPS = 2;
+		const int LIMIT = GROUPS * hashTable::GROUP_SIZE * 7 / 8;
+		int keys[8 * GROUPS * hashTable::GROUP_SIZE];
+		vector<int*> home[GROUPS];
+		for (int i = 0; i < sizeof keys / sizeof keys[0]; i++)
+			home[hashTable::h1(hashTable::hashPointer(&keys[i])) & (GROUPS - 1)].push_back(&keys[i]);
+		if (home[0].size() <= hashTable::GROUP_SIZE || home[1].size() <= LIMIT - hashTable::GROUP_SIZE) {
+			printf("Too few keys in each home group\n");
+			return false;
+		}
+		map<int, int> m;
+		for (int i = 0; i < hashTable::GROUP_SIZE; i++)
+			m.insert(home[0][i], i);
+		for (int i = hashTable::GROUP_SIZE; i < LIMIT; i++)
+			m.insert(home[1][i - hashTable::GROUP_SIZE], i);
+		if (m.capacity() != GROUPS * hashTable::GROUP_SIZE) {
+			printf("%d keys made a table of %d slots\n", LIMIT, m.capacity());
+			return false;
+		}
+		for (int i = 0; i < hashTable::GROUP_SIZE; i++)
+			m.erase(home[0][i]);
+		m.insert(home[1][LIMIT - hashTable::GROUP_SIZE], LIMIT);
+		if (m.capacity() != GROUPS * hashTable::GROUP_SIZE) {
+			printf("Tombstones grew the table from %d to %d\n", GROUPS * hashTable::GROUP_SIZE, m.capacity());
+			return false;
+		}
+		if (m.size() != LIMIT - hashTable::GROUP_SIZE + 1) {
+			printf("Rebuilt table has %d entries, expected %d\n", m.size(), LIMIT - hashTable::GROUP_SIZE + 1);
+			return false;
+		}
+		for (int i = 0; i < hashTable::GROUP_SIZE; i++) {
+			if (m.probe(home[0][i])) {
+				printf("Erased key %d present after rebuild\n", i);
+				return false;
+			}
+		}
+		for (int i = hashTable::GROUP_SIZE; i <= LIMIT; i++) {
+			if (*m.get(home[1][i - hashTable::GROUP_SIZE]) != i) {
+				printf("Key %d has value %d after rebuild\n", i, *m.get(home[1][i - hashTable::GROUP_SIZE]));
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool check(const map<int, int>& m, int from, int to, int stride, const char* when) {
+		for (int i = from; i < to; i += stride) {
+			if (!m.probe(&_keys[i])) {
+				printf("Key %d missing %s\n", i, when);
+				return false;
+			}
+			if (*m.get(&_keys[i]) != i) {
+				printf("Key %d has value %d %s\n", i, *m.get(&_keys[i]), when);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool checkIteration(const map<int, int>& m, int from, int to, int stride, const char* when) {
+		vector<bool> seen;
+		seen.resize(_keys.size());
+		seen.setAll(false);
+		int visited = 0;
+		for (map<int, int>::iterator i = m.begin(); i.valid(); i.next()) {
+			int k = int(i.key() - &_keys[0]);
+			if (k < from || k >= to || (k - from) % stride != 0) {
+				printf("Iteration %s visited key %d\n", when, k);
+				return false;
+			}
+			if (seen[k]) {
+				printf("Iteration %s visited key %d twice\n", when, k);
+				return false;
+			}
+			if (*i != k) {
+				printf("Iteration %s found value %d for key %d\n", when, *i, k);
+				return false;
+			}
+			seen[k] = true;
+			visited++;
+		}
+		if (visited != m.size()) {
+			printf("Iteration %s visited %d keys, size is %d\n", when, visited, m.size());
+			return false;
+		}
+		return true;
+	}
+
+	vector<int>		_keys;
+};
+
+/*
+ *	HashSetObject
+ *
+ *	Exercises hashSet insert, erase and probe as the table grows, as
+ *	erased keys leave tombstones behind and as keys are reinserted over
+ *	them.  The whole set is checked against a table of which keys
+ *	should be in it.  The 'count' property sets the number of keys
+ *	(default 1000).
+ */
+class HashSetObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new HashSetObject();
+	}
+
+	HashSetObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		int count = 1000;
+		Atom* a = get("count");
+		if (a)
+			count = a->toString().toInt();
+		if (count < 2) {
+			printf("count must be at least 2\n");
+			return false;
+		}
+		_keys.resize(2 * count);
+		_in.resize(_keys.size());
+		_in.setAll(false);
+
+		hashSet<int> s;
+		for (int i = 0; i < count; i++) {
+			if (!insert(&s, i))
+				return false;
+			if ((i & (i + 1)) == 0 && !check(s, "while growing"))
+				return false;
+		}
+		if (!check(s, "after insert"))
+			return false;
+
+			// Erase every other key, then put them back.
+
+		for (int i = 0; i < count; i += 2)
+			if (!erase(&s, i))
+				return false;
+		if (!check(s, "after erase"))
+			return false;
+		for (int i = 0; i < count; i += 2)
+			if (!insert(&s, i))
+				return false;
+		if (!check(s, "after reinsert"))
+			return false;
+
+			// Slide a window of count / 2 live keys across all of the
+			// keys.
+
+		s.clear();
+		_in.setAll(false);
+		int window = count / 2;
+		for (int i = 0; i < window; i++)
+			if (!insert(&s, i))
+				return false;
+		for (int i = window; i < _keys.size(); i++) {
+			if (!erase(&s, i - window) || !insert(&s, i))
+				return false;
+			if (i % 97 == 0 && !check(s, "while sliding"))
+				return false;
+		}
+		if (!check(s, "after sliding window"))
+			return false;
+		return runAnyContent();
+	}
+
+private:
+	bool insert(hashSet<int>* s, int i) {
+		if (!s->insert(&_keys[i])) {
+			printf("Insert of key %d failed\n", i);
+			return false;
+		}
+		if (s->insert(&_keys[i])) {
+			printf("Second insert of key %d succeeded\n", i);
+			return false;
+		}
+		_in[i] = true;
+		return true;
+	}
+
+	bool erase(hashSet<int>* s, int i) {
+		if (!s->erase(&_keys[i])) {
+			printf("Erase of key %d failed\n", i);
+			return false;
+		}
+		if (s->erase(&_keys[i])) {
+			printf("Second erase of key %d succeeded\n", i);
+			return false;
+		}
+		_in[i] = false;
+		return true;
+	}
+
+	bool check(const hashSet<int>& s, const char* when) {
+		int expected = 0;
+		for (int i = 0; i < _keys.size(); i++) {
+			if (s.probe(&_keys[i]) != _in[i]) {
+				printf("Key %d is %s %s\n", i, _in[i] ? "missing" : "present", when);
+				return false;
+			}
+			if (_in[i])
+				expected++;
+		}
+		vector<bool> seen;
+		seen.resize(_keys.size());
+		seen.setAll(false);
+		int visited = 0;
+		for (hashSet<int>::iterator i = s.begin(); i.valid(); i.next()) {
+			int k = int(*i - &_keys[0]);
+			if (!_in[k] || seen[k]) {
+				printf("Iteration %s visited key %d %s\n", when, k, seen[k] ? "twice" : "not in the set");
+				return false;
+			}
+			seen[k] = true;
+			visited++;
+		}
+		if (visited != expected || s.size() != expected) {
+			printf("Iteration %s visited %d keys, size is %d, expected %d\n", when, visited, s.size(), expected);
+			return false;
+		}
+		return true;
+	}
+
+	vector<int>		_keys;
+	vector<bool>	_in;
+};
+
+/*
+ *	BitVectorObject
+ *
+ *	Sets patterns of bits in vectors whose sizes fall on either side
+ *	of the 32 bit word and 128 bit block boundaries, and checks test,
+ *	count and findFirst, and then unionWith and intersectWith of
+ *	vectors of different sizes, against tables of bools.
+ */
+class BitVectorObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new BitVectorObject();
+	}
+
+	BitVectorObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		static const int sizes[] = { 1, 31, 32, 33, 63, 64, 65, 127, 128, 129, 300 };
+		static const int count = sizeof sizes / sizeof sizes[0];
+		for (int i = 0; i < count; i++) {
+			for (int j = 0; j < count; j++) {
+				vector<bool> ra, rb;
+				bitVector a = pattern(sizes[i], 3, &ra);
+				bitVector b = pattern(sizes[j], 5, &rb);
+				if (!check(a, ra, "set") || !check(b, rb, "set"))
+					return false;
+
+				bitVector u(a);
+				vector<bool> ru;
+				combine(ra, rb, true, &ru);
+				u.unionWith(b);
+				if (!check(u, ru, "after unionWith"))
+					return false;
+
+				bitVector n(a);
+				vector<bool> rn;
+				combine(ra, rb, false, &rn);
+				n.intersectWith(b);
+				if (!check(n, rn, "after intersectWith"))
+					return false;
+
+					// Bits dropped by a shrink come back as zeroes.
+
+				a.resize(sizes[i] / 2);
+				a.resize(sizes[i]);
+				for (int k = sizes[i] / 2; k < sizes[i]; k++)
+					ra[k] = false;
+				if (!check(a, ra, "after shrinking and growing"))
+					return false;
+			}
+		}
+		return runAnyContent();
+	}
+
+private:
+	/*
+	 *	pattern
+	 *
+	 *	Sets every 'stride'th bit and the bits either side of each word
+	 *	boundary, then resets every seventh.
+	 */
+	static bitVector pattern(int size, int stride, vector<bool>* r) {
+		bitVector v(size);
+		r->resize(size);
+		r->setAll(false);
+		for (int k = 0; k < size; k++) {
+			if (k % stride == 0 || (k & 31) == 0 || (k & 31) == 31) {
+				v.set(k);
+				(*r)[k] = true;
+			}
+		}
+		for (int k = 0; k < size; k += 7) {
+			v.reset(k);
+			(*r)[k] = false;
+		}
+		return v;
+	}
+
+	static void combine(const vector<bool>& a, const vector<bool>& b, bool either, vector<bool>* r) {
+		int size = a.size();
+		if (either && b.size() > size)
+			size = b.size();
+		r->resize(size);
+		for (int k = 0; k < size; k++) {
+			bool x = k < a.size() && a[k];
+			bool y = k < b.size() && b[k];
+			(*r)[k] = either ? x || y : x && y;
+		}
+	}
+
+	static bool check(const bitVector& v, const vector<bool>& r, const char* when) {
+		if (v.size() != r.size()) {
+			printf("bitVector %s has size %d, expected %d\n", when, v.size(), r.size());
+			return false;
+		}
+		int expected = 0;
+		for (int k = 0; k < r.size(); k++) {
+			if (v.test(k) != r[k]) {
+				printf("Bit %d of %d is %d %s\n", k, r.size(), v.test(k), when);
+				return false;
+			}
+			if (r[k])
+				expected++;
+		}
+		if (v.count() != expected) {
+			printf("bitVector of %d %s has count %d, expected %d\n", r.size(), when, v.count(), expected);
+			return false;
+		}
+		for (int start = 0; start <= r.size(); start++) {
+			int first = start;
+			while (first < r.size() && !r[first])
+				first++;
+			if (first >= r.size())
+				first = -1;
+			if (v.findFirst(start) != first) {
+				printf("bitVector of %d %s: findFirst(%d) is %d, expected %d\n", r.size(), when, start, v.findFirst(start), first);
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/*
+ *	DictionaryObject
+ *
+ *	Exercises dictionary remove: lookups that must miss after a
+ *	removal, and insertion order surviving removes, reinserts and the
+ *	rehash that squeezes removed entries out.  The 'count' property
+ *	sets the number of keys (default 1000).
+ */
+class DictionaryObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new DictionaryObject();
+	}
+
+	DictionaryObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		int count = 1000;
+		Atom* a = get("count");
+		if (a)
+			count = a->toString().toInt();
+		if (count < 3) {
+			printf("count must be at least 3\n");
+			return false;
+		}
+		dictionary<int> d;
+		for (int i = 0; i < count; i++)
+			if (!add(&d, i))
+				return false;
+		if (!checkOrder(d, "after insert"))
+			return false;
+
+			// Remove every third key.
+
+		for (int i = 0; i < count; i += 3) {
+			if (!d.remove(key(i))) {
+				printf("remove of %s failed\n", key(i).c_str());
+				return false;
+			}
+			_order.remove(_order.find(i));
+		}
+		if (d.remove(key(0))) {
+			printf("Second remove of %s succeeded\n", key(0).c_str());
+			return false;
+		}
+		for (int i = 0; i < count; i++) {
+			string k = key(i);
+			bool present = i % 3 != 0;
+			if (d.probe(k) != present || d.probe(k.c_str()) != present) {
+				printf("probe of %s is %s after remove\n", k.c_str(), present ? "false" : "true");
+				return false;
+			}
+			int* v = d.find(k);
+			if (present ? v == null || *v != i : v != null) {
+				printf("find of %s is wrong after remove\n", k.c_str());
+				return false;
+			}
+			int expected = present ? i : 0;
+			if (*d.get(k) != expected || *d.get(k.c_str(), k.size()) != expected) {
+				printf("get of %s is %d after remove, expected %d\n", k.c_str(), *d.get(k), expected);
+				return false;
+			}
+		}
+		if (!checkOrder(d, "after remove"))
+			return false;
+
+			// Put the removed keys back, in reverse order, then add as
+			// many new keys again so the dictionary has to grow.
+
+		for (int i = (count - 1) / 3 * 3; i >= 0; i -= 3)
+			if (!add(&d, i))
+				return false;
+		if (!checkOrder(d, "after reinsert"))
+			return false;
+		for (int i = count; i < 2 * count; i++) {
+			if (!add(&d, i))
+				return false;
+			if (i % 5 == 0) {
+				d.remove(key(i - 1));
+				_order.remove(_order.find(i - 1));
+			}
+		}
+		if (!checkOrder(d, "after grow"))
+			return false;
+		for (int i = 0; i < _order.size(); i++) {
+			if (*d.get(key(_order[i])) != _order[i]) {
+				printf("get of %s is %d after grow\n", key(_order[i]).c_str(), *d.get(key(_order[i])));
+				return false;
+			}
+		}
+		return runAnyContent();
+	}
+
+private:
+	static string key(int i) {
+		return string("key") + string(i);
+	}
+
+	bool add(dictionary<int>* d, int i) {
+		if (!d->insert(key(i), i)) {
+			printf("insert of %s failed\n", key(i).c_str());
+			return false;
+		}
+		_order.push_back(i);
+		return true;
+	}
+
+	bool checkOrder(const dictionary<int>& d, const char* when) {
+		if (d.size() != _order.size()) {
+			printf("Size is %d %s, expected %d\n", d.size(), when, _order.size());
+			return false;
+		}
+		int n = 0;
+		for (dictionary<int>::iterator i = d.begin(); i.valid(); i.next(), n++) {
+			if (n >= _order.size()) {
+				printf("Iteration %s visited more than %d entries\n", when, _order.size());
+				return false;
+			}
+			if (i.key() != key(_order[n]) || *i != _order[n]) {
+				printf("Iteration %s found %s = %d at %d, expected %s\n", when, i.key().c_str(), *i, n, key(_order[n]).c_str());
+				return false;
+			}
+		}
+		if (n != _order.size()) {
+			printf("Iteration %s visited %d entries, expected %d\n", when, n, _order.size());
+			return false;
+		}
+		return true;
+	}
+
+	vector<int>		_order;				// the keys that should be present, in insertion order
+};
+
+/*
+ *	StringObject
+ *
+ *	Checks strings at the boundary between inline and heap storage:
+ *	21, 22 and 23 characters, built directly, by append and by
+ *	push_back, then copied, moved and hashed.  The hash of every
+ *	result must agree with a fresh hash of the same text.  Then builds
+ *	a line with StringBuilder, with and without room reserved for it,
+ *	and checks find, rfind and count, with keys short enough for the
+ *	SSE2 search and long enough for the two-way search, against a
+ *	naive search.
+ */
+class StringObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new StringObject();
+	}
+
+	StringObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		const char* alphabet = "abcdefghijklmnopqrstuvwxyz";
+		for (int length = 21; length <= 23; length++) {
+			string expected(alphabet, length);
+			if (!check(expected, alphabet, length, "constructed"))
+				return false;
+			string fromText(expected.c_str());
+			if (!check(fromText, alphabet, length, "from text"))
+				return false;
+
+				// Grow to 'length' from one character short, and from
+				// the empty string.
+
+			string appended(alphabet, length - 1);
+			appended.hashValue();
+			appended.append(alphabet + length - 1, 1);
+			if (!check(appended, alphabet, length, "after append"))
+				return false;
+			string pushed(alphabet, length - 1);
+			pushed.hashValue();
+			pushed.push_back(alphabet[length - 1]);
+			if (!check(pushed, alphabet, length, "after push_back"))
+				return false;
+			string concatenated;
+			concatenated += string(alphabet, 10);
+			concatenated += string(alphabet + 10, length - 10);
+			if (!check(concatenated, alphabet, length, "after +="))
+				return false;
+
+				// Grow from 'length' across the next boundary too.
+
+			string longer(expected);
+			longer.hashValue();
+			longer.append(alphabet + length, 1);
+			if (!check(longer, alphabet, length + 1, "after append past it"))
+				return false;
+
+			string copied(expected);
+			if (!check(copied, alphabet, length, "copied"))
+				return false;
+			string assigned("x");
+			assigned = expected;
+			if (!check(assigned, alphabet, length, "assigned"))
+				return false;
+			string shorter(alphabet, 3);
+			shorter = longer;
+			if (!check(shorter, alphabet, length + 1, "assigned over a short string"))
+				return false;
+
+			string source(expected);
+			source.hashValue();
+			string moved(static_cast<string&&>(source));
+			if (!check(moved, alphabet, length, "moved"))
+				return false;
+			if (source.size() != 0 || *source.c_str() != 0) {
+				printf("Moved from string of length %d is not empty\n", length);
+				return false;
+			}
+			string moveAssigned("y");
+			moveAssigned = static_cast<string&&>(moved);
+			if (!check(moveAssigned, alphabet, length, "move assigned"))
+				return false;
+			if (moved.size() != 0) {
+				printf("Move assigned from string of length %d is not empty\n", length);
+				return false;
+			}
+
+				// Writing through operator [] must drop the cached hash.
+
+			string modified(expected);
+			int before = modified.hashValue();
+			modified[length - 1] = '!';
+			if (modified.hashValue() != string::hashValue(modified.c_str(), length) ||
+				modified.hashValue() == before) {
+				printf("Hash of length %d not updated after a write\n", length);
+				return false;
+			}
+			if (modified == expected) {
+				printf("Modified copy of length %d still equals the original\n", length);
+				return false;
+			}
+			if (expected.c_str()[length - 1] != alphabet[length - 1]) {
+				printf("Writing to a copy of length %d changed the original\n", length);
+				return false;
+			}
+		}
+		if (!checkBuilder(0) || !checkBuilder(4) || !checkBuilder(100))
+			return false;
+		if (!checkSearch())
+			return false;
+		return runAnyContent();
+	}
+
+private:
+	/*
+	 *	checkSearch
+	 *
+	 *	The texts are periodic, or random over two letters, so that
+	 *	keys taken from them match in many places, and partial matches
+	 *	are everywhere.  Keys are taken from the start, the middle and
+	 *	the end of each text, as they are and with their first or last
+	 *	byte changed, and some periodic keys are made up.
+	 */
+	bool checkSearch() {
+		static const int keyLengths[] = { 2, 5, 15, 16, 31, 32, 33, 64, 100, 257 };
+		vector<string> texts;
+		texts.push_back(repeat("ab", 600));
+		texts.push_back(repeat("a", 700) + "b");
+		texts.push_back(repeat("aab", 300));
+		unsigned seed = 1;
+		string mixed;
+		for (int i = 0; i < 2000; i++) {
+			seed = seed * 1103515245 + 12345;
+			mixed.push_back((seed >> 16) & 1 ? 'a' : 'b');
+		}
+		texts.push_back(mixed);
+		for (int t = 0; t < texts.size(); t++) {
+			const string& text = texts[t];
+			for (int j = 0; j < sizeof keyLengths / sizeof keyLengths[0]; j++) {
+				int length = keyLengths[j];
+				if (length > text.size())
+					continue;
+				vector<string> keys;
+				keys.push_back(text.substr(0, length));
+				keys.push_back(text.substr(text.size() / 2, length));
+				keys.push_back(text.substr(text.size() - length, length));
+				for (int k = 0; k < 3; k++) {
+					string changed(keys[k]);
+					changed[0] = 'z';
+					keys.push_back(changed);
+					changed = keys[k];
+					changed[length - 1] = 'z';
+					keys.push_back(changed);
+				}
+				keys.push_back(repeat("ab", length).substr(0, length));
+				keys.push_back(repeat("ba", length).substr(0, length));
+				keys.push_back(repeat("a", length));
+				keys.push_back(repeat("a", length - 1) + "b");
+				keys.push_back("b" + repeat("a", length - 1));
+				for (int k = 0; k < keys.size(); k++)
+					if (!checkSearch(text, keys[k], t))
+						return false;
+			}
+		}
+		return true;
+	}
+
+	bool checkSearch(const string& text, const string& key, int t) {
+		for (int offset = 0; offset <= text.size(); offset += offset < 40 ? 1 : 97) {
+			if (text.find(key, offset) != naiveFind(text, key, offset)) {
+				printf("Text %d: find of a %d byte key from %d is %d, expected %d\n", t, key.size(), offset,
+					text.find(key, offset), naiveFind(text, key, offset));
+				return false;
+			}
+		}
+		int last = string::npos;
+		for (int i = naiveFind(text, key, 0); i != string::npos; i = naiveFind(text, key, i + 1))
+			last = i;
+		if (text.rfind(key) != last) {
+			printf("Text %d: rfind of a %d byte key is %d, expected %d\n", t, key.size(), text.rfind(key), last);
+			return false;
+		}
+		int n = 0;
+		for (int i = naiveFind(text, key, 0); i != string::npos; i = naiveFind(text, key, i + key.size()))
+			n++;
+		if (text.count(key) != n) {
+			printf("Text %d: count of a %d byte key is %d, expected %d\n", t, key.size(), text.count(key), n);
+			return false;
+		}
+		return true;
+	}
+
+	static int naiveFind(const string& text, const string& key, int offset) {
+		for (int i = offset; i + key.size() <= text.size(); i++)
+			if (memcmp(text.c_str() + i, key.c_str(), key.size()) == 0)
+				return i;
+		return string::npos;
+	}
+
+	static string repeat(const char* s, int times) {
+		string r;
+		for (int i = 0; i < times; i++)
+			r.append(s);
+		return r;
+	}
+
+	bool checkBuilder(int capacity) {
+		static const char* expected = "add @-42: object 7 at 2.5, x\n";
+		StringBuilder b(capacity);
+		for (int i = 0; i < 2; i++) {
+			b << "add @" << -42 << ": " << string("object ") << 7u << " at " << 2.5 << ',';
+			b.append(" x\n", 3);
+			if (b.size() != strlen(expected)) {
+				printf("StringBuilder(%d) has size %d, expected %d\n", capacity, b.size(), (int)strlen(expected));
+				return false;
+			}
+			string s = b.toString();
+			if (!check(s, expected, strlen(expected), "built"))
+				return false;
+			if (b.size() != 0) {
+				printf("StringBuilder(%d) is not empty after toString\n", capacity);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool check(const string& s, const char* text, int length, const char* when) {
+		if (s.size() != length) {
+			printf("Length %d string %s has size %d\n", length, when, s.size());
+			return false;
+		}
+		if (memcmp(s.c_str(), text, length) != 0 || s.c_str()[length] != 0) {
+			printf("Length %d string %s has text '%s'\n", length, when, s.c_str());
+			return false;
+		}
+		int hash = string::hashValue(text, length);
+		if (s.hashValue() != hash || s.hashValue() != hash) {
+			printf("Length %d string %s has hash %x, expected %x\n", length, when, s.hashValue(), hash);
+			return false;
+		}
+		if (s != string(text, length)) {
+			printf("Length %d string %s does not equal its text\n", length, when);
+			return false;
+		}
+		return true;
+	}
+};
+
+/*
+ *	NumberObject
+ *
+ *	Formats doubles and parses them back: fixed cases with known
+ *	shortest text, including subnormals, huge values, signed zero,
+ *	infinities and NaN, then 'count' random bit patterns (default
+ *	10000).  Every value must read back bit for bit.  Long inputs,
+ *	well past the 64 characters that used to go to strtod, must still
+ *	parse to the nearest double.
+ */
+class NumberObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new NumberObject();
+	}
+
+	NumberObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		int count = 10000;
+		Atom* a = get("count");
+		if (a)
+			count = a->toString().toInt();
+
+		static const struct {
+			double		value;
+			const char*	text;
+		} cases[] = {
+			{ 0.0,						"0" },
+			{ -0.0,						"-0" },
+			{ 1.0,						"1" },
+			{ 0.1,						"0.1" },
+			{ 4.35,						"4.35" },
+			{ 0.0001,					"0.0001" },
+			{ 1e-05,					"1e-05" },
+			{ 1e-30,					"1e-30" },
+			{ 1e16,						"10000000000000000" },
+			{ 1e17,						"1e+17" },
+			{ 1e23,						"1e+23" },
+			{ 1e300,					"1e+300" },
+			{ 1.7976931348623157e308,	"1.7976931348623157e+308" },
+			{ 2.2250738585072014e-308,	"2.2250738585072014e-308" },	// smallest normal
+			{ 2.225073858507201e-308,	"2.225073858507201e-308" },		// largest subnormal
+			{ 5e-324,					"5e-324" },						// smallest subnormal
+			{ -1.5e-320,				"-1.5e-320" },
+			{ 9007199254740992.0,		"9007199254740992" },
+		};
+		char buffer[number::MAX_LENGTH];
+		for (int i = 0; i < sizeof cases / sizeof cases[0]; i++) {
+			int n = number::format(buffer, cases[i].value);
+			if (strcmp(buffer, cases[i].text) != 0 || n != strlen(buffer)) {
+				printf("%s formatted as '%s' (%d)\n", cases[i].text, buffer, n);
+				return false;
+			}
+			if (!roundTrip(cases[i].value))
+				return false;
+		}
+
+		double inf = 1e308 * 10;
+		if (!formatsAs(inf, "inf") || !formatsAs(-inf, "-inf") || !formatsAs(inf - inf, "nan"))
+			return false;
+		if (!parsesAs("inf", inf) || !parsesAs("-Infinity", -inf) || !parsesAs("1e400", inf) ||
+			!parsesAs("-1e400", -inf) || !parsesAs("1e-400", 0) || !parsesAs("-0.0", -0.0))
+			return false;
+		double x;
+		if (number::parse("NaN", 3, &x) != 3 || x == x) {
+			printf("NaN did not parse as a NaN\n");
+			return false;
+		}
+
+			// Long inputs.  The first is 1 followed by 80 zeros, the next
+			// two sit just either side of the halfway point between 1 and
+			// the next double up, which only the last digit decides.
+
+		string digits("1");
+		for (int i = 0; i < 80; i++)
+			digits.push_back('0');
+		if (!parsesAs(digits.c_str(), 1e80))
+			return false;
+		string below("1.00000000000000011102230246251565404236316680908203124");
+		for (int i = 0; i < 40; i++)
+			below.push_back('9');
+		if (!parsesAs(below.c_str(), 1.0))
+			return false;
+		string above("1.00000000000000011102230246251565404236316680908203125");
+		for (int i = 0; i < 900; i++)
+			above.push_back('0');
+		above.push_back('1');
+		if (!parsesAs(above.c_str(), 1.0000000000000002))
+			return false;
+		string halfway("1.00000000000000011102230246251565404236316680908203125");
+		for (int i = 0; i < 900; i++)
+			halfway.push_back('0');
+		if (!parsesAs(halfway.c_str(), 1.0))						// a tie goes to even
+			return false;
+		string subnormal("0.");
+		for (int i = 0; i < 323; i++)
+			subnormal.push_back('0');
+		subnormal.append("4940656458412465441765687928682213723650598026143247644255856825");
+		if (!parsesAs(subnormal.c_str(), 5e-324))
+			return false;
+
+		random::Random r(count);
+		for (int i = 0; i < count; i++) {
+			unsigned __int64 bits = ((unsigned __int64)r.next() << 32) | r.next();
+			memcpy(&x, &bits, sizeof x);
+			if (x != x || x - x != 0)
+				continue;
+			if (!roundTrip(x))
+				return false;
+		}
+		return runAnyContent();
+	}
+
+private:
+	bool roundTrip(double x) {
+		char buffer[number::MAX_LENGTH];
+		int n = number::format(buffer, x);
+		double y;
+		int used = number::parse(buffer, n, &y);
+		if (used != n || memcmp(&x, &y, sizeof x) != 0) {
+			printf("%s read back as %.17g (%d of %d characters)\n", buffer, y, used, n);
+			return false;
+		}
+		return true;
+	}
+
+	bool formatsAs(double x, const char* text) {
+		char buffer[number::MAX_LENGTH];
+		number::format(buffer, x);
+		if (strcmp(buffer, text) != 0) {
+			printf("%s formatted as '%s'\n", text, buffer);
+			return false;
+		}
+		return true;
+	}
+
+	bool parsesAs(const char* text, double expected) {
+		int length = strlen(text);
+		double x;
+		int used = number::parse(text, length, &x);
+		if (used != length || memcmp(&x, &expected, sizeof x) != 0) {
+			printf("%.40s... (%d characters) parsed as %.17g using %d\n", text, length, x, used);
+			return false;
+		}
+		return true;
+	}
+};
+
+/*
+ *	XmlLoadObject
+ *
+ *	Loads the same files with Document::load and Document::loadLazily,
+ *	exact and not, and checks that the two trees agree node for node:
+ *	kind, tag, text, location and attributes.  Some of the files take
+ *	the lazy loader's fast path; others (CDATA, a declaration, stray
+ *	text outside the root, a bad escape, a mismatched tag) make it fall
+ *	back to a full load.  The 'file' property names the scratch file
+ *	(default xml_load_test.xml), which is erased afterwards.
+ */
+class XmlLoadObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new XmlLoadObject();
+	}
+
+	XmlLoadObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		string filename("xml_load_test.xml");
+		Atom* a = get("file");
+		if (a)
+			filename = a->toString();
+
+		static const char* files[] = {
+			"<a id=\"x\" b='1'>text &amp; more<b/><!-- note --><c v=\"&lt;&gt;\">t</c></a>",
+			"<!-- before -->\n<root>\n  <x n=\"1\">\n    <y/>\n  </x>\n  <x n=\"2\">two</x>\n</root>\n<!-- after -->\n",
+			"<a><b><c><d>deep</d></c></b><e/></a>",
+			"<a><![CDATA[<raw> & text]]></a>",
+			"<!DOCTYPE a>\n<a>x</a>",
+			"stray<a/>",
+			"<a/>stray",
+			"<a>&bogus;</a>",
+			"<a><b></a>",
+			"<a x=\"&quot;&apos;\">&lt;&amp;&gt;</a>",
+		};
+		for (int i = 0; i < sizeof files / sizeof files[0]; i++) {
+			FILE* fp = fileSystem::createTextFile(filename);
+			if (fp == null) {
+				printf("Could not create %s\n", filename.c_str());
+				return false;
+			}
+			fwrite(files[i], 1, strlen(files[i]), fp);
+			fclose(fp);
+			for (int exact = 0; exact < 2; exact++) {
+				xml::Document full;
+				xml::Document lazy;
+				bool loaded = full.load(filename, exact != 0);
+				bool loadedLazily = lazy.loadLazily(filename, exact != 0);
+				if (loaded != loadedLazily || full.parseError() != lazy.parseError()) {
+					printf("File %d exact %d: load returned %d, loadLazily %d\n", i, exact, loaded, loadedLazily);
+					return false;
+				}
+				if (!compare(full.root(), lazy.root(), i)) {
+					printf("File %d exact %d: trees differ\n", i, exact);
+					return false;
+				}
+				if (!compareStream(&full, filename, exact != 0, i))
+					return false;
+			}
+		}
+		if (!checkChunkBoundaries(filename))
+			return false;
+		fileSystem::erase(filename);
+		return runAnyContent();
+	}
+
+private:
+	/*
+	 *	checkChunkBoundaries
+	 *
+	 *	A stream is read in 64K chunks.  Each of these pieces is put
+	 *	across the end of the first chunk at every offset, after a text
+	 *	node that pads it out, and the document streamed is compared
+	 *	with the one loaded whole.
+	 */
+	bool checkChunkBoundaries(const string& filename) {
+		static const int CHUNK = 64 * 1024;
+		static const char* pieces[] = {
+			"<!-- a comment - with a->b and -- dashes -->",
+			"<![CDATA[raw <text> & ]] brackets q]>z]]>",
+			"<e first=\"one &amp; two\" second = 'three'  third=\"&lt;four&gt;\"/>",
+			"some text &amp; an &lt;escape&gt; or two",
+		};
+		static const char* head = "<root><pad>";
+		static const char* padEnd = "</pad>";
+		static const char* tail = "<last/></root>\n";
+		int file = 100;
+		for (int i = 0; i < sizeof pieces / sizeof pieces[0]; i++) {
+			int length = strlen(pieces[i]);
+			for (int offset = 1; offset < length; offset++, file++) {
+				FILE* fp = fileSystem::createBinaryFile(filename);
+				if (fp == null) {
+					printf("Could not create %s\n", filename.c_str());
+					return false;
+				}
+				fputs(head, fp);
+				int pad = CHUNK - offset - strlen(head) - strlen(padEnd);
+				for (int j = 0; j < pad; j++)
+					fputc('x', fp);
+				fputs(padEnd, fp);
+				fputs(pieces[i], fp);
+				fputs(tail, fp);
+				fclose(fp);
+				for (int exact = 0; exact < 2; exact++) {
+					xml::Document full;
+					if (!full.load(filename, exact != 0)) {
+						printf("Piece %d offset %d exact %d: could not load\n", i, offset, exact);
+						return false;
+					}
+					if (!compareStream(&full, filename, exact != 0, file))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool compareStream(xml::Document* full, const string& filename, bool exact, int file) {
+		FILE* fp = fileSystem::openBinaryFile(filename);
+		if (fp == null) {
+			printf("Could not open %s\n", filename.c_str());
+			return false;
+		}
+		xml::Document streamed;
+		streamed.load(fp, exact);
+		fclose(fp);
+		if (full->parseError() != streamed.parseError()) {
+			printf("File %d exact %d: parseError %d loaded, %d streamed\n", file, exact, full->parseError(), streamed.parseError());
+			return false;
+		}
+		if (!compare(full->root(), streamed.root(), file)) {
+			printf("File %d exact %d: streamed tree differs\n", file, exact);
+			return false;
+		}
+		return true;
+	}
+
+	bool compare(xml::Element* e, xml::Element* f, int file) {
+		for (; e != null || f != null; e = e->sibling, f = f->sibling) {
+			if (e == null || f == null) {
+				printf("File %d: one tree has an extra %s node\n", file, e ? "loaded" : "lazily loaded");
+				return false;
+			}
+			if (e->kind != f->kind || e->tag != f->tag || e->text != f->text || e->location != f->location) {
+				printf("File %d: node kind %d <%s> '%.*s' @%d differs from kind %d <%s> '%.*s' @%d\n", file,
+					e->kind, e->tag.c_str(), e->text.size(), e->text.text(), int(e->location),
+					f->kind, f->tag.c_str(), f->text.size(), f->text.text(), int(f->location));
+				return false;
+			}
+			xml::Attribute* a = e->attributes;
+			xml::Attribute* b = f->attributes;
+			for (; a != null || b != null; a = a->next, b = b->next) {
+				if (a == null || b == null) {
+					printf("File %d: <%s> has a different number of attributes\n", file, e->tag.c_str());
+					return false;
+				}
+				if (a->name != b->name || a->value != b->value || a->location != b->location) {
+					printf("File %d: <%s> attribute %s='%.*s' differs from %s='%.*s'\n", file, e->tag.c_str(),
+						a->name.c_str(), a->value.size(), a->value.text(),
+						b->name.c_str(), b->value.size(), b->value.text());
+					return false;
+				}
+			}
+			if (!compare(e->firstChild(), f->firstChild(), file))
+				return false;
+		}
+		return true;
+	}
+};
+
+/*
+ *	XmlIdObject
+ *
+ *	Checks that Document::getValue follows the tree as it is edited,
+ *	for a document loaded in full and one loaded lazily: elements
+ *	extracted and appended again, ids set, changed and removed with
+ *	Document::setValue, two elements with the same id, and a lazily
+ *	loaded subtree extracted before any of it has been made.  The
+ *	'file' property names the scratch file (default xml_id_test.xml),
+ *	which is erased afterwards.
+ */
+class XmlIdObject : script::Object {
+public:
+	static script::Object* factory() {
+		return new XmlIdObject();
+	}
+
+	XmlIdObject() {}
+
+	virtual bool isRunnable() const { return true; }
+
+	virtual bool run() {
+		string filename("xml_id_test.xml");
+		Atom* a = get("file");
+		if (a)
+			filename = a->toString();
+
+		static const char* text =
+			"<r><a id=\"one\"><b id=\"two\"/></a><c id=\"dup\"/><d id=\"dup\"><e id=\"deep\"/></d>"
+			"<f><g id=\"lazy\"><h id=\"inner\"/></g></f><i id=\"x&amp;y\"/></r>";
+		FILE* fp = fileSystem::createTextFile(filename);
+		if (fp == null) {
+			printf("Could not create %s\n", filename.c_str());
+			return false;
+		}
+		fwrite(text, 1, strlen(text), fp);
+		fclose(fp);
+		bool result = true;
+		for (int lazily = 0; lazily < 2 && result; lazily++) {
+			_lazily = lazily != 0;
+			result = checkEdits(filename) && checkUnmadeSubtree(filename);
+		}
+		fileSystem::erase(filename);
+		if (!result)
+			return false;
+		return runAnyContent();
+	}
+
+private:
+	bool checkEdits(const string& filename) {
+		xml::Document doc;
+		if (!load(&doc, filename))
+			return false;
+		if (!expect(&doc, "one", "a") || !expect(&doc, "two", "b") || !expect(&doc, "dup", "c") ||
+			!expect(&doc, "deep", "e") || !expect(&doc, "x&y", "i") || !expect(&doc, "x&amp;y", null) ||
+			!expect(&doc, "nope", null))
+			return false;
+		xml::Element* r = doc.root();
+		xml::Element* a = doc.getValue("one");
+
+			// Extract a subtree and put it back.
+
+		a->extract();
+		if (!expect(&doc, "one", null) || !expect(&doc, "two", null))
+			return false;
+		r->append(a);
+		if (!expect(&doc, "one", "a") || !expect(&doc, "two", "b"))
+			return false;
+
+			// Change, remove and add ids.
+
+		Symbol id("id");
+		string uno("uno");
+		doc.setValue(a, id, &uno, script::FILE_OFFSET_UNDEFINED);
+		if (!expect(&doc, "one", null) || !expect(&doc, "uno", "a"))
+			return false;
+		doc.setValue(a, id, null, script::FILE_OFFSET_UNDEFINED);
+		if (!expect(&doc, "uno", null))
+			return false;
+		xml::Element* f = child(r, "f");
+		string eff("eff");
+		doc.setValue(f, id, &eff, script::FILE_OFFSET_UNDEFINED);
+		if (!expect(&doc, "eff", "f"))
+			return false;
+
+			// Duplicate ids: the first element has the id until it
+			// leaves the tree or loses the id.
+
+		xml::Element* c = doc.getValue("dup");
+		c->extract();
+		if (!expect(&doc, "dup", "d"))
+			return false;
+		xml::Element* d = doc.getValue("dup");
+		doc.setValue(d, id, null, script::FILE_OFFSET_UNDEFINED);
+		if (!expect(&doc, "dup", null) || !expect(&doc, "deep", "e"))
+			return false;
+		r->append(c);
+		if (!expect(&doc, "dup", "c"))
+			return false;
+		return true;
+	}
+	/*
+	 *	checkUnmadeSubtree
+	 *
+	 *	Extracts <f> without ever asking for its children, so in a lazy
+	 *	load none of them has been made.
+	 */
+	bool checkUnmadeSubtree(const string& filename) {
+		xml::Document doc;
+		if (!load(&doc, filename))
+			return false;
+		xml::Element* r = doc.root();
+		xml::Element* f = child(r, "f");
+		f->extract();
+		if (!expect(&doc, "lazy", null) || !expect(&doc, "inner", null) || !expect(&doc, "one", "a"))
+			return false;
+		r->append(f);
+		if (!expect(&doc, "inner", "h") || !expect(&doc, "lazy", "g"))
+			return false;
+		f->extract();
+		if (!expect(&doc, "lazy", null) || !expect(&doc, "inner", null))
+			return false;
+		return true;
+	}
+
+	bool load(xml::Document* doc, const string& filename) {
+		bool loaded = _lazily ? doc->loadLazily(filename, false) : doc->load(filename, false);
+		if (!loaded) {
+			printf("Could not load %s\n", filename.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	xml::Element* child(xml::Element* parent, const char* tag) {
+		for (xml::Element* e = parent->firstChild(); e != null; e = e->sibling)
+			if (e->kind == xml::ELEMENT && e->tag == tag)
+				return e;
+		return null;
+	}
+
+	bool expect(xml::Document* doc, const char* id, const char* tag) {
+		xml::Element* e = doc->getValue(id);
+		if (tag == null ? e != null : e == null || e->tag != tag) {
+			printf("%s load: id '%s' found <%s>, expected <%s>\n", _lazily ? "Lazy" : "Full", id,
+				e ? e->tag.c_str() : "none", tag ? tag : "none");
+			return false;
+		}
+		return true;
+	}
+
+	bool	_lazily;
+};
+
 void initCommonTestObjects() {
 	script::objectFactory("function", FunctionObject::factory);
 	script::objectFactory("functionValue", FunctionValueObject::factory);
@@ -419,4 +2081,15 @@ void initCommonTestObjects() {
 	script::objectFactory("vector", VectorObject::factory);
 	script::objectFactory("vectorValue", VectorValueObject::factory);
 	script::objectFactory("hillClimb", HillClimbObject::factory);
+	script::objectFactory("parallelSort", ParallelSortObject::factory);
+	script::objectFactory("searchIndex", SearchIndexObject::factory);
+	script::objectFactory("btree", BtreeObject::factory);
+	script::objectFactory("map", MapObject::factory);
+	script::objectFactory("hashSet", HashSetObject::factory);
+	script::objectFactory("bitVector", BitVectorObject::factory);
+	script::objectFactory("dictionary", DictionaryObject::factory);
+	script::objectFactory("string", StringObject::factory);
+	script::objectFactory("number", NumberObject::factory);
+	script::objectFactory("xmlLoad", XmlLoadObject::factory);
+	script::objectFactory("xmlId", XmlIdObject::factory);
 }
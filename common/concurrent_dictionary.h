@@ -0,0 +1,130 @@
+#pragma once
+#include "dictionary.h"
+#include "process.h"
+#include "string.h"
+/*
+ *	concurrentDictionary
+ *
+ *	A string keyed dictionary that may be shared by many threads.  Keys
+ *	are spread over SHARDS independent dictionaries by the top bits of
+ *	their hash, and each shard has its own lock, so threads working on
+ *	different keys seldom wait on one another.
+ *
+ *	Values are returned by copy, since a pointer into a shard would not
+ *	survive another thread's insert.  The dictionary is meant to hold
+ *	pointers or other small values.
+ */
+template<class A, class Keys = CaseSensitiveKeys>
+class concurrentDictionary {
+public:
+	static const int SHARD_BITS = 4;
+	static const int SHARDS = 1 << SHARD_BITS;
+	/*
+	 *	get
+	 *
+	 *	RETURNS:
+	 *		The value stored for 'key', or an empty value (see
+	 *		dictionary::replace) if there is none.
+	 */
+	A get(const string& key) const {
+		const Shard& s = shard(Keys::hash(key));
+		process::MutexLock m(&s.lock);
+		return *s.table.get(key);
+	}
+
+	bool probe(const string& key) const {
+		const Shard& s = shard(Keys::hash(key));
+		process::MutexLock m(&s.lock);
+		return s.table.probe(key);
+	}
+
+	bool put(const string& key, const A& value) {
+		Shard& s = shard(Keys::hash(key));
+		process::MutexLock m(&s.lock);
+		return s.table.put(key, value);
+	}
+
+	bool insert(const string& key, const A& value) {
+		Shard& s = shard(Keys::hash(key));
+		process::MutexLock m(&s.lock);
+		return s.table.insert(key, value);
+	}
+
+	bool remove(const string& key) {
+		Shard& s = shard(Keys::hash(key));
+		process::MutexLock m(&s.lock);
+		return s.table.remove(key);
+	}
+	/*
+	 *	getOrInsert
+	 *
+	 *	If 'key' has no entry, calls factory(key) and stores the result.
+	 *	The factory runs under the key's shard lock, so it is called at
+	 *	most once per key however many threads ask for the key at the
+	 *	same time.  It must not use this dictionary.
+	 *
+	 *	RETURNS:
+	 *		The value stored for 'key', either the one already there or
+	 *		the one just made.
+	 */
+	template<class F>
+	A getOrInsert(const string& key, F factory) {
+		Shard& s = shard(Keys::hash(key));
+		process::MutexLock m(&s.lock);
+		A* entry = s.table.find(key);
+		if (entry != null)
+			return *entry;
+		A value = factory(key);
+		s.table.insert(key, value);
+		return value;
+	}
+	/*
+	 *	size
+	 *
+	 *	The shards are counted one at a time, so while other threads
+	 *	are inserting or removing, the result is only approximate.
+	 */
+	int size() const {
+		int n = 0;
+		for (int i = 0; i < SHARDS; i++) {
+			process::MutexLock m(&_shards[i].lock);
+			n += _shards[i].table.size();
+		}
+		return n;
+	}
+
+	void deleteAll() {
+		for (int i = 0; i < SHARDS; i++) {
+			process::MutexLock m(&_shards[i].lock);
+			_shards[i].table.deleteAll();
+		}
+	}
+
+	void clear() {
+		for (int i = 0; i < SHARDS; i++) {
+			process::MutexLock m(&_shards[i].lock);
+			_shards[i].table.clear();
+		}
+	}
+
+private:
+	struct Shard {
+		mutable process::Mutex		lock;
+		dictionary<A, Keys>			table;
+	};
+	/*
+	 *	shard
+	 *
+	 *	The dictionaries themselves index by the low bits of the hash,
+	 *	so shards are picked by the high ones.
+	 */
+	Shard& shard(int hash) {
+		return _shards[(unsigned)hash >> (32 - SHARD_BITS)];
+	}
+
+	const Shard& shard(int hash) const {
+		return _shards[(unsigned)hash >> (32 - SHARD_BITS)];
+	}
+
+	Shard			_shards[SHARDS];
+};
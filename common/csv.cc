@@ -15,7 +15,7 @@ bool parseCsv(const string& data, vector<vector<string> >* output) {
 			if (cp == null)
 				return false;
 
-			row->push_back(item);
+			row->push_back(static_cast<string&&>(item));
 			if (*cp == ',')
 				cp++;
 			if (*cp == '\n')
@@ -48,10 +48,10 @@ static const char* parseItem(const char* cp, string* output) {
 			}
 		}
 	} else {
-		while (*cp && *cp != ',' && *cp != '\n') {
-			output->push_back(*cp);
+		const char* start = cp;
+		while (*cp && *cp != ',' && *cp != '\n')
 			cp++;
-		}
+		output->append(start, (int)(cp - start));
 		return cp;
 	}
 	return null;
@@ -26,11 +26,10 @@ Web::~Web() {
 void Web::add(ObjectBase* object) {
 	process::MutexLock m(&_lock);
 
-	debugPrint(string("add @") + int(object) + ": " + object->toString() + "\n");
+	debugPrint((StringBuilder() << "add @" << int(object) << ": " << object->toString() << "\n").toString());
 	// If the object is already known, don't add it again.
-	for (int i = 0; i < _objects.size(); i++)
-		if (_objects[i] == object)
-			return;
+	if (!_known.insert(object))
+		return;
 	_objects.push_back(object);
 	if (current())
 		_currentGeneration = _builtGeneration + 1;
@@ -50,10 +49,7 @@ void Web::touch() {
 bool Web::has(ObjectBase* object) {
 	process::MutexLock m(&_lock);
 
-	for (int i = 0; i < _objects.size(); i++)
-		if (_objects[i] == object)
-			return true;
-	return false;
+	return _known.probe(object);
 }
 
 void Web::forget(ObjectBase* object) {
@@ -71,6 +67,7 @@ void Web::forget(ObjectBase* object) {
 		else if (object->dependencies_size() > 0)
 			object->removeDependency(_objects[i]);
 	if (deleteThis >= 0) {
+		_known.erase(object);
 		if (deleteThis != _objects.size() - 1)
 			_objects[deleteThis] = _objects[_objects.size() - 1];
 		_objects.resize(_objects.size() - 1);
@@ -90,10 +87,10 @@ ObjectBase* Web::objectBuiltFrom(ObjectBase* dependency, int i) {
 	process::MutexLock m(&_lock);
 
 	if (_objects[i]->_derivatives.size() > i) {
-		debugPrint("objectBuiltFrom " + dependency->toString() + " " + i + ": " + _objects[i]->_derivatives[i]->toString() + "\n");
+		debugPrint((StringBuilder() << "objectBuiltFrom " << dependency->toString() << " " << i << ": " << _objects[i]->_derivatives[i]->toString() << "\n").toString());
 		return _objects[i]->_derivatives[i];
 	} else {
-		debugPrint("objectBuiltFrom " + dependency->toString() + " " + i + ": null\n");
+		debugPrint((StringBuilder() << "objectBuiltFrom " << dependency->toString() << " " << i << ": null\n").toString());
 		return null;
 	}
 }
@@ -130,7 +127,7 @@ void Web::makeCurrent() {
 // *** Runs on worker thread ***
 void Web::buildFinished(ObjectBase* object, bool success) {
 	process::MutexLock m(&_lock);
-	debugPrint("@" + string(int(object)) + ": " + object->toString() + " buildFinished: " + int(success) + "\n");
+	debugPrint((StringBuilder() << "@" << int(object) << ": " << object->toString() << " buildFinished: " << int(success) << "\n").toString());
 	object->_busy = false;
 	object->_builtGeneration = _buildingGeneration;
 	object->_ready.signal();
@@ -201,9 +198,9 @@ void Web::wait(unsigned millisecondsWait) {
 }
 
 void Web::debugDump() {
-	debugPrint(string("idle threads ") + _workers->idleThreads() + " building " + _buildingGeneration + " built " + _builtGeneration + "\n");
+	debugPrint((StringBuilder() << "idle threads " << _workers->idleThreads() << " building " << _buildingGeneration << " built " << _builtGeneration << "\n").toString());
 	for (int i = 0; i < _objects.size(); i++) {
-		debugPrint(string("[") + i + "]: " + _objects[i]->toString() + "(gen " + _objects[i]->_generation + " built " + _objects[i]->_builtGeneration + ")");
+		debugPrint((StringBuilder() << "[" << i << "]: " << _objects[i]->toString() << "(gen " << _objects[i]->_generation << " built " << _objects[i]->_builtGeneration << ")").toString());
 		if (_objects[i]->_busy)
 			debugPrint(" (busy)");
 		if (_objects[i]->unfinished(_buildingGeneration))
@@ -1,7 +1,8 @@
 #pragma once
 #include <time.h>
-#include "dictionary.h"
+#include "concurrent_dictionary.h"
 #include "file_system.h"
+#include "map.h"
 #include "process.h"
 #include "string.h"
 #include "vector.h"
@@ -67,6 +68,25 @@ public:
 
 	void add(ObjectBase* object);
 
+	/*
+	 *	manageFile
+	 *
+	 *	Finds or creates the object in 'catalog' for 'filename'.  Only
+	 *	the catalog shard holding 'filename' is locked for the lookup;
+	 *	the web lock is taken just to link a newly created object to
+	 *	its source.
+	 */
+	template<class D, class S>
+	D* manageFile(const string& filename, S* source, concurrentDictionary<D*>* catalog) {
+		return catalog->getOrInsert(filename, FileFactory<D, S>(this, source));
+	}
+	/*
+	 *	manageFile
+	 *
+	 *	As above, for a plain dictionary catalog.  The whole lookup is
+	 *	done under the web lock, so the catalog must not be changed by
+	 *	anything that does not also hold it.
+	 */
 	template<class D, class S>
 	D* manageFile(const string& filename, S* source, dictionary<D*>* catalog) {
 		process::MutexLock m(&_lock);
@@ -135,6 +155,26 @@ public:
 	void debugDump();
 
 private:
+	template<class D, class S>
+	class FileFactory {
+	public:
+		FileFactory(Web* web, S* source) {
+			_web = web;
+			_source = source;
+		}
+
+		D* operator () (const string& filename) const {
+			D* file = new D(_source);
+			process::MutexLock m(&_web->_lock);
+			file->dependsOn(_source);
+			return file;
+		}
+
+	private:
+		Web*	_web;
+		S*		_source;
+	};
+
 	class Waiters {
 	public:
 		process::SignalingEvent		waitEvent;
@@ -153,6 +193,7 @@ private:
 
 	process::Mutex					_lock;
 	vector<ObjectBase*>				_objects;				// guarded by _lock
+	hashSet<ObjectBase>				_known;					// the members of _objects, guarded by _lock
 	process::ThreadPool*			_workers;				// guarded by _lock
 	int								_currentGeneration;		// guarded by _lock
 	int								_builtGeneration;		// guarded by _lock
@@ -1,28 +1,153 @@
 #pragma once
 #include "../common/string.h"
+#include "../common/vector.h"
+/*
+ *	dictionary
+ *
+ *	A string keyed hash table laid out like a CPython dict.  The entries
+ *	(hash, key and value) are kept in a dense array in insertion order,
+ *	and a separate, sparse index table of ints maps hash slots to entry
+ *	positions.  Small dictionaries therefore cost an 8 slot index and a
+ *	handful of entries, rather than a full table of strings.
+ *
+ *	Each entry caches its key's hash: probes reject mismatches without
+ *	comparing strings and a rehash only rebuilds the index, without
+ *	rehashing or copying any keys.  Iteration walks the dense array, so
+ *	it visits entries in the order they were inserted and costs time in
+ *	proportion to the number of entries, not the table size.
+ *
+ *	Removed entries are left in the dense array, flagged, until the next
+ *	rehash squeezes them out.
+ *
+ *	The Keys class decides which keys are the same: CaseSensitiveKeys
+ *	(the default) or IgnoreCaseKeys.  Either way, keys are stored and
+ *	iterated as they were first inserted.
+ */
+struct CaseSensitiveKeys {
+	static int hash(const string& key) {
+		return key.hashValue();
+	}
+
+	static int hash(const char* key, int length) {
+		return string::hashValue(key, length);
+	}
+
+	static bool equal(const char* a, const char* b, int length) {
+		return memcmp(a, b, length) == 0;
+	}
+};
+/*
+ *	IgnoreCaseKeys
+ *
+ *	Treats keys that differ only in the case of ASCII letters as the
+ *	same key.  Keys are hashed and compared case-insensitively in place,
+ *	without making lower case copies.
+ */
+struct IgnoreCaseKeys {
+	static int hash(const string& key) {
+		return key.hashValueIgnoreCase();
+	}
+
+	static int hash(const char* key, int length) {
+		return string::hashValueIgnoreCase(key, length);
+	}
+
+	static bool equal(const char* a, const char* b, int length) {
+		return string::equalsIgnoreCase(a, b, length);
+	}
+};
 
-template<class A>
+template<class A, class Keys = CaseSensitiveKeys>
 class dictionary {
 public:
 	dictionary() {
-		_entries = null;
-		clear();
+		_index = null;
+		_indexSize = 0;
+		_entriesCount = 0;
 	}
 
 	~dictionary() {
-		delete [] _entries;
+		delete [] _index;
 	}
-
+	/*
+	 *	get
+	 *
+	 *	RETURNS:
+	 *		A pointer to the value stored for 'key'.  If there is no
+	 *		entry for the key, a pointer to an empty value (see replace,
+	 *		below) is returned.  That value must not be modified.
+	 */
 	A* get(const string& key) {
-		return &findEntry(key)->value;
+		int i = lookup(key.c_str(), key.size(), Keys::hash(key));
+		if (i >= 0)
+			return &_entries[i].value;
+		else
+			return emptyValue();
 	}
 
 	const A* get(const string& key) const {
-		return &findEntry(key)->value;
+		int i = lookup(key.c_str(), key.size(), Keys::hash(key));
+		if (i >= 0)
+			return &_entries[i].value;
+		else
+			return emptyValue();
+	}
+	/*
+	 *	get
+	 *
+	 *	These overloads, and the like overloads of probe and insert,
+	 *	take the key as text the caller owns, so a probe allocates
+	 *	nothing.  The key is hashed exactly as a string key would be.
+	 */
+	A* get(const char* key) {
+		return get(key, strlen(key));
+	}
+
+	const A* get(const char* key) const {
+		return get(key, strlen(key));
+	}
+
+	A* get(const char* key, int length) {
+		int i = lookup(key, length, Keys::hash(key, length));
+		if (i >= 0)
+			return &_entries[i].value;
+		else
+			return emptyValue();
+	}
+
+	const A* get(const char* key, int length) const {
+		int i = lookup(key, length, Keys::hash(key, length));
+		if (i >= 0)
+			return &_entries[i].value;
+		else
+			return emptyValue();
+	}
+
+	/*
+	 *	find
+	 *
+	 *	RETURNS:
+	 *		A pointer to the value stored for 'key', or null if there
+	 *		is no entry for the key.
+	 */
+	A* find(const string& key) {
+		int i = lookup(key.c_str(), key.size(), Keys::hash(key));
+		if (i >= 0)
+			return &_entries[i].value;
+		else
+			return null;
 	}
 
 	bool probe(const string& key) const {
-		return findEntry(key)->valid;
+		return lookup(key.c_str(), key.size(), Keys::hash(key)) >= 0;
+	}
+
+	bool probe(const char* key) const {
+		return probe(key, strlen(key));
+	}
+
+	bool probe(const char* key, int length) const {
+		return lookup(key, length, Keys::hash(key, length)) >= 0;
 	}
 	/*
 	 *	put
@@ -37,19 +162,13 @@ public:
 	 *		was replaced.
 	 */
 	bool put(const string& key, const A& value) {
-		Entry* e = findEntry(key);
-		if (!e->valid) {
-			if (tooFull()) {
-				rehash();
-				e = findEntry(key);
-			}
-			e->valid = true;
-			e->key = key;
-			e->value = value;
-			_entriesCount++;
+		int hash = Keys::hash(key);
+		int i = lookup(key.c_str(), key.size(), hash);
+		if (i < 0) {
+			addEntry(key, hash)->value = value;
 			return true;
 		} else {
-			e->value = value;
+			_entries[i].value = value;
 			return false;
 		}
 	}
@@ -64,21 +183,14 @@ public:
 	 * or zero if it is a scalar type.
 	 */
 	A replace(const string& key, const A& value) {
-		Entry* e = findEntry(key);
-		if (!e->valid) {
-			static A empty;
-			if (tooFull()) {
-				rehash();
-				e = findEntry(key);
-			}
-			e->valid = true;
-			e->key = key;
-			e->value = value;
-			_entriesCount++;
-			return empty;
+		int hash = Keys::hash(key);
+		int i = lookup(key.c_str(), key.size(), hash);
+		if (i < 0) {
+			addEntry(key, hash)->value = value;
+			return *emptyValue();
 		} else {
-			A v = e->value;
-			e->value = value;
+			A v = _entries[i].value;
+			_entries[i].value = value;
 			return v;
 		}
 	}
@@ -95,54 +207,78 @@ public:
 	 *		dictionary.
 	 */
 	bool insert(const string& key, const A& value) {
-		Entry* e = findEntry(key);
-		if (!e->valid) {
-			if (tooFull()) {
-				rehash();
-				e = findEntry(key);
-			}
-			e->valid = true;
-			e->key = key;
-			e->value = value;
-			_entriesCount++;
-			return true;
-		} else
+		int hash = Keys::hash(key);
+		if (lookup(key.c_str(), key.size(), hash) >= 0)
 			return false;
+		addEntry(key, hash)->value = value;
+		return true;
+	}
+
+	bool insert(const char* key, int length, const A& value) {
+		int hash = Keys::hash(key, length);
+		if (lookup(key, length, hash) >= 0)
+			return false;
+		addEntry(string(key, length), hash)->value = value;
+		return true;
+	}
+	/*
+	 *	remove
+	 *
+	 *	Removes the entry for 'key', if there is one.
+	 *
+	 *	RETURNS:
+	 *		true - if an entry was removed.
+	 *		false - there was no entry for the key.
+	 */
+	bool remove(const string& key) {
+		int hash = Keys::hash(key);
+		int slot = findSlot(key.c_str(), key.size(), hash);
+		if (slot < 0)
+			return false;
+		Entry& e = _entries[_index[slot]];
+		_index[slot] = REMOVED_INDEX;
+		e.removed = true;
+		e.key.clear();
+		e.value = A();
+		_entriesCount--;
+		return true;
 	}
 
 	void deleteAll() {
-		dictionary<A>::iterator i = begin();
-		while (i.hasNext()) {
-			delete (*i);
-			i.next();
-		}
+		for (int i = 0; i < _entries.size(); i++)
+			if (!_entries[i].removed)
+				delete _entries[i].value;
 		clear();
 	}
 
 	void clear() {
-		delete [] _entries;
-		_entries = null;
+		delete [] _index;
+		_index = null;
+		_indexSize = 0;
+		_entries.clear();
 		_entriesCount = 0;
-		_allocatedEntries = INITIAL_TABLE_SIZE / 2;
-		rehash();
 	}
 
 	class iterator {
 		friend dictionary;
 	public:
 		bool hasNext() {
-			return _index < _dictionary->_allocatedEntries;
+			return _index < _dictionary->_entries.size();
+		}
+
+		bool valid() {
+			return hasNext();
 		}
 
 		void next() {
 			do
 				_index++;
-			while (_index < _dictionary->_allocatedEntries &&
-				   !_dictionary->_entries[_index].valid);
+			while (_index < _dictionary->_entries.size() &&
+				   _dictionary->_entries[_index].removed);
 		}
 
 		A& operator* () {
-			return _dictionary->_entries[_index].value;
+			return const_cast<A&>(_dictionary->_entries[_index].value);
 		}
 
 		const string& key() {
@@ -150,91 +286,163 @@ public:
 		}
 
 	private:
-		iterator(const dictionary<A>* dict) {
+		iterator(const dictionary* dict) {
 			_dictionary = dict;
 			_index = 0;
 		}
 
 		int						_index;
-		const dictionary<A>*	_dictionary;
+		const dictionary*	_dictionary;
 	};
 
 	friend iterator;
 
 	iterator begin() const {
 		iterator i(this);
-		if (_entriesCount == 0)
-			i._index = _allocatedEntries;
-		else {
-			for (i._index = 0; i._index < _allocatedEntries; i._index++) {
-				if (_entries[i._index].valid)
-					break;
-			}
-		}
+		while (i._index < _entries.size() && _entries[i._index].removed)
+			i._index++;
 		return i;
 	}
 
 	int size() const { return _entriesCount; }
 
 private:
-	static const int INITIAL_TABLE_SIZE	= 64;		// must be power of two
-	static const int REHASH_SHIFT = 3;				// rehash at ((1 << REHASH_SHIFT) - 1) / (1 << REHASH_SHIFT) keys filled
+	static const int INITIAL_INDEX_SIZE = 8;		// must be power of two
+	static const int EMPTY_INDEX = -1;
+	static const int REMOVED_INDEX = -2;
+	static const int PERTURB_SHIFT = 5;
 
 	struct Entry {
+		int		hash;
+		bool	removed;
 		string	key;
 		A		value;
-		bool	valid;
 	};
 
-	Entry* findEntry(const string& key) {
-		int x = key.hashValue() & (_allocatedEntries - 1);
-		int startx = x;
-		for(;;) {
-			Entry* e = &_entries[x];
-			if (!e->valid || e->key == key)
-				return e;
-			x++;
-			if (x >= _allocatedEntries)
-				x = 0;
-		};
+	static A* emptyValue() {
+		static A empty;
+		return &empty;
 	}
-
-	const Entry* findEntry(const string& key) const {
-		int x = key.hashValue() & (_allocatedEntries - 1);
-		int startx = x;
-		for(;;) {
-			Entry* e = &_entries[x];
-			if (!e->valid || e->key == key)
-				return e;
-			x++;
-			if (x >= _allocatedEntries)
-				x = 0;
-		};
+	/*
+	 *	usable
+	 *
+	 *	The dense array may fill to 2/3 of the index size before
+	 *	the next entry forces a rehash.
+	 */
+	static int usable(int indexSize) {
+		return (indexSize << 1) / 3;
 	}
-
-	bool tooFull() {
-		return _entriesCount > _rehashThreshold;
+	/*
+	 *	findSlot
+	 *
+	 *	Probes the index the way CPython does: the next slot depends on
+	 *	the upper bits of the hash as well as the lower ones, so keys
+	 *	that collide in the low bits quickly go separate ways.
+	 *
+	 *	RETURNS:
+	 *		The index slot holding the entry for the 'length' bytes at
+	 *		'key', or -1 if there is no such entry.
+	 */
+	int findSlot(const char* key, int length, int hash) const {
+		if (_indexSize == 0)
+			return -1;
+		unsigned mask = _indexSize - 1;
+		unsigned perturb = hash;
+		unsigned x = hash & mask;
+		for (;;) {
+			int i = _index[x];
+			if (i == EMPTY_INDEX)
+				return -1;
+			if (i >= 0) {
+				const Entry& e = _entries[i];
+				if (e.hash == hash && e.key.size() == length &&
+					Keys::equal(e.key.c_str(), key, length))
+					return x;
+			}
+			perturb >>= PERTURB_SHIFT;
+			x = (5 * x + 1 + perturb) & mask;
+		}
 	}
 
+	int lookup(const char* key, int length, int hash) const {
+		int slot = findSlot(key, length, hash);
+		if (slot < 0)
+			return -1;
+		else
+			return _index[slot];
+	}
+	/*
+	 *	freeSlot
+	 *
+	 *	Returns the first index slot along the probe sequence for 'hash'
+	 *	that does not refer to an entry.
+	 */
+	int freeSlot(int hash) const {
+		unsigned mask = _indexSize - 1;
+		unsigned perturb = hash;
+		unsigned x = hash & mask;
+		while (_index[x] >= 0) {
+			perturb >>= PERTURB_SHIFT;
+			x = (5 * x + 1 + perturb) & mask;
+		}
+		return x;
+	}
+	/*
+	 *	addEntry
+	 *
+	 *	Appends an entry for a key known not to be present.
+	 */
+	Entry* addEntry(const string& key, int hash) {
+		if (_entries.size() >= usable(_indexSize))
+			rehash();
+		int slot = freeSlot(hash);
+		_index[slot] = _entries.size();
+		Entry& e = _entries.emplace_back();
+		e.hash = hash;
+		e.removed = false;
+		e.key = key;
+		_entriesCount++;
+		return &e;
+	}
+	/*
+	 *	rehash
+	 *
+	 *	Squeezes removed entries out of the dense array and rebuilds
+	 *	the index, sized so that the live entries fill no more than
+	 *	half of the usable space.  Keys are not touched: the stored
+	 *	hashes are all that is needed to place them.  The dense array
+	 *	is given room for the usable space, which its power of two
+	 *	blocks round up to the index size: 8 entries for the first
+	 *	index, not the 16 a default vector would start with.
+	 */
 	void rehash() {
-		Entry* oldE = _entries;
-		_allocatedEntries *= 2;
-		_entries = new Entry[_allocatedEntries];
-		memset(_entries, 0, _allocatedEntries * sizeof (Entry));
-		int e = _entriesCount;
-		_entriesCount = 0;
-		for (int i = 0; e > 0; i++) {
-			if (oldE[i].valid) {
-				insert(oldE[i].key, oldE[i].value);
-				e--;
+		int live = 0;
+		for (int i = 0; i < _entries.size(); i++) {
+			if (!_entries[i].removed) {
+				if (live != i)
+					_entries[live] = static_cast<Entry&&>(_entries[i]);
+				live++;
 			}
 		}
-		_rehashThreshold = (_allocatedEntries * ((1 << REHASH_SHIFT) - 1)) >> REHASH_SHIFT;
-		delete [] oldE;
+		_entries.resize(live);
+
+		int newSize = INITIAL_INDEX_SIZE;
+		while (usable(newSize) < 2 * live + 1)
+			newSize <<= 1;
+		if (newSize != _indexSize) {
+			delete [] _index;
+			_index = new int[newSize];
+			_indexSize = newSize;
+		}
+		for (int i = 0; i < newSize; i++)
+			_index[i] = EMPTY_INDEX;
+		for (int i = 0; i < live; i++)
+			_index[freeSlot(_entries[i].hash)] = i;
+		_entries.reserve(usable(newSize));
 	}
 
-	Entry*		_entries;
-	int			_entriesCount;
-	int			_allocatedEntries;
-	int			_rehashThreshold;
+	int*			_index;				// _indexSize slots: entry position, EMPTY_INDEX or REMOVED_INDEX
+	int				_indexSize;			// always 0 or a power of two
+	vector<Entry, 4>	_entries;		// in insertion order, including removed entries
+	int				_entriesCount;		// live entries
 };
@@ -1,52 +1,47 @@
 #pragma once
+#include "list.h"
 #define null 0
 
 class BaseEvent_ {
 public:
+	/*
+	 *	removeHandler
+	 *
+	 *	'h' must be a value returned by addHandler on this event.  The
+	 *	handlers are kept on a doubly linked list, so removing one takes
+	 *	constant time however many there are.
+	 */
 	void removeHandler(void* h) {
 		if (h == null)
 			return;
-		if (handlers == null)
+		BaseHandler_* bh = (BaseHandler_*)h;
+		if (bh->removed)
 			return;
-		if (h == handlers)
-			handlers = handlers->next;
-		else {
-			for (BaseHandler_* hh = handlers; ; hh = hh->next) {
-				if (hh->next == null)
-					return;
-				if (hh->next == h) {
-					hh->next = hh->next->next;
-					break;
-				}
-			}
-		}
-		if (!((BaseHandler_*)h)->busy)
-			delete h;
+		handlers.remove(bh);
+		if (!bh->busy)
+			delete bh;
 		else
-			((BaseHandler_*)h)->removed = true;
+			bh->removed = true;
 	}
 
 	void removeHandlers() {
-		while (handlers)
-			removeHandler(handlers);
+		while (!handlers.empty())
+			removeHandler(handlers.first());
 	}
 
-	bool has_listeners() { return handlers != 0; }
+	bool has_listeners() { return !handlers.empty(); }
 
 protected:
 	BaseEvent_() {
-		handlers = null;
 	}
 
 	~BaseEvent_() {
-		while (handlers)
-			removeHandler(handlers);
+		removeHandlers();
 	}
 
-	struct BaseHandler_ {
+	struct BaseHandler_ : listNode<BaseHandler_> {
 		virtual ~BaseHandler_() { }
 
-		BaseHandler_*	next;
 		bool			busy;				// busy is true whenever the handler function is being called
 		bool			removed;			// removed is true whenever the handler was removed while busy
 	};
@@ -54,12 +49,11 @@ protected:
 	void* append(BaseHandler_* h) {
 		h->busy = false;
 		h->removed = false;
-		h->next = handlers;
-		handlers = h;
+		handlers.push_front(h);
 		return h;
 	}
 
-	BaseHandler_*	handlers;
+	list<BaseHandler_>	handlers;
 };
 
 class Event : public BaseEvent_ {
@@ -94,11 +88,11 @@ public:
 	}
 
 	void fire() {
-		for (BaseHandler_* h = handlers; h; ) {
+		for (BaseHandler_* h = handlers.first(); h; ) {
 			h->busy = true;
 			((Handler*)h)->fire();
 			h->busy = false;
-			BaseHandler_* hNext = h->next;
+			BaseHandler_* hNext = h->next();
 			if (h->removed)
 				delete h;
 			h = hNext;
@@ -240,11 +234,11 @@ public:
 	}
 
 	void fire(A a) {
-		for (BaseHandler_* h = handlers; h; ) {
+		for (BaseHandler_* h = handlers.first(); h; ) {
 			h->busy = true;
 			((Handler*)h)->fire(a);
 			h->busy = false;
-			BaseHandler_* hNext = h->next;
+			BaseHandler_* hNext = h->next();
 			if (h->removed)
 				delete h;
 			h = hNext;
@@ -346,12 +340,12 @@ public:
 	}
 
 	void fire(A a, B b) {
-		for (BaseHandler_* h = handlers; h; ) {
+		for (BaseHandler_* h = handlers.first(); h; ) {
 
 			h->busy = true;
 			((Handler*)h)->fire(a, b);
 			h->busy = false;
-			BaseHandler_* hNext = h->next;
+			BaseHandler_* hNext = h->next();
 			if (h->removed)
 				delete h;
 			h = hNext;
@@ -453,11 +447,11 @@ public:
 	}
 
 	void fire(A a, B b, C c) {
-		for (BaseHandler_* h = handlers; h; ) {
+		for (BaseHandler_* h = handlers.first(); h; ) {
 			h->busy = true;
 			((Handler*)h)->fire(a, b, c);
 			h->busy = false;
-			BaseHandler_* hNext = h->next;
+			BaseHandler_* hNext = h->next();
 			if (h->removed)
 				delete h;
 			h = hNext;
@@ -549,11 +543,11 @@ public:
 	}
 
 	void fire(A a, B b, C c, D d) {
-		for (BaseHandler_* h = handlers; h; ) {
+		for (BaseHandler_* h = handlers.first(); h; ) {
 			h->busy = true;
 			((Handler*)h)->fire(a, b, c, d);
 			h->busy = false;
-			BaseHandler_* hNext = h->next;
+			BaseHandler_* hNext = h->next();
 			if (h->removed)
 				delete h;
 			h = hNext;
@@ -108,8 +108,8 @@ string constructPath(const string& directory, const string& baseName, const stri
 			base.resize(base.size() - extSize);
 		}
 		if (extension[0] != '.')
-			base = base + ".";
-		base = base + extension;
+			base.push_back('.');
+		base.append(extension);
 	}
 	return base;
 }
@@ -893,21 +893,14 @@ bool Storage::dump(const string& schemaFile) {
 
 
 Storage::Writer* Storage::lookup(const void* t) {
-	string s;
-
-	char* buf = s.buffer_(sizeof t);
-	*(const void**)buf = t;
-	return *_index.get(s);
+	return *_index.get((const char*)&t, sizeof t);
 }
 
 void Storage::reserve(Storage::Writer* o) {
 	o->init(this, _objects.size() + 1);
 	_objects.push_back(o);
-	string s;
-
-	char* buf = s.buffer_(sizeof (void*));
-	*(void**)buf = o->object();
-	_index.insert(s, o);
+	void* object = o->object();
+	_index.insert((const char*)&object, sizeof object, o);
 }
 
 void Storage::startOfRecord(char recordKey) {
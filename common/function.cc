@@ -1,25 +1,27 @@
 #include "../common/platform.h"
 #include "function.h"
 
+/*
+ *	value
+ *
+ *	Points are sorted into the table in one batch, the next time the
+ *	function is evaluated.  Points with the same x are kept in the
+ *	order they were given.
+ */
 void Function::value(double x, double y) {
 	Pair p = { x, y };
-
-	for (int i = 0; i < _table.size(); i++) {
-		if (x < _table[i].x) {
-			_table.insert(i, p);
-			return;
-		}
-	}
-	_table.push_back(p);
+	_table.append(p);
+	_indexed = false;
 }
 
 double Function::operator ()(double x) {
-	Pair p = { x };
-	int i = binarySearchClosestGreater(_table, p);
-	if (i == -1) {
+	if (_table.size() == 0) {
 		double y = 0;
 		return y / y;
 	}
+	if (!_indexed)
+		buildIndex();
+	int i = _xIndex.lowerBound(x);
 	if (i == _table.size()) {
 		const Pair& p = _table[_table.size() - 1];
 
@@ -35,3 +37,12 @@ double Function::operator ()(double x) {
 		return left.y + (x - left.x) * (right.y - left.y) / (right.x - left.x);
 	}
 }
+
+void Function::buildIndex() {
+	vector<double> xs;
+	xs.reserve(_table.size());
+	for (int i = 0; i < _table.size(); i++)
+		xs.push_back(_table[i].x);
+	_xIndex.build(xs);
+	_indexed = true;
+}
@@ -1,11 +1,13 @@
 #pragma once
-#include "vector.h"
+#include "search_index.h"
+#include "sorted_vector.h"
 
 class Function {
 public:
 	explicit Function(double leftSlope = 0, double rightSlope = 0) {
 		_leftSlope = leftSlope;
 		_rightSlope = rightSlope;
+		_indexed = false;
 	}
 
 	void value(double x, double y);
@@ -30,7 +32,11 @@ private:
 		}
 	};
 
-	vector<Pair>	_table;
-	double			_leftSlope;
-	double			_rightSlope;
+	void buildIndex();
+
+	sortedVector<Pair>	_table;
+	searchIndex<double>	_xIndex;			// the x of each point in _table, valid when _indexed
+	bool				_indexed;
+	double				_leftSlope;
+	double				_rightSlope;
 };
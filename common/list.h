@@ -1,27 +1,211 @@
 #pragma once
 #define null 0
 
+template<class I>
+class list;
+template<class I>
+class queue;
+/*
+ *	listNode
+ *
+ *	The links an element needs to be on a list.  A class whose objects
+ *	go on lists derives from listNode of itself:
+ *
+ *		class Job : public listNode<Job> { ... };
+ *
+ *	An element can be on only one list at a time.  The list does not
+ *	own its elements: it neither allocates nor deletes them.
+ */
+template<class I>
+class listNode {
+	friend class list<I>;
+public:
+	I* next() const { return static_cast<I*>(_next); }
+
+	I* prev() const { return static_cast<I*>(_prev); }
+
+protected:
+	listNode() {
+		_next = null;
+		_prev = null;
+	}
+
+private:
+	listNode<I>*	_next;
+	listNode<I>*	_prev;
+};
+/*
+ *	list
+ *
+ *	An intrusive doubly linked list with head and tail pointers.  Every
+ *	operation, including removing an element from the middle and
+ *	splicing one list onto another, takes constant time.
+ *
+ *	Removing an element does not clear its own links, so a walk over
+ *	the list that is standing on an element when it is removed can
+ *	still step to the next one.
+ */
 template<class I>
 class list {
 public:
 	list() {
-		_base = null;
-	}
-
-	void pop(I* me) {
-		if (me->next() == me) {
-			if (me != _base) {
-				// Inconsistency: why are you trying to pop an item off a list it isn't part of?
-				// TODO: add error handling
-			}
-			_base = null;
-		} else {
-			if (me == _base)
-				_base = _me->next();
-			me->pop();
+		_first = null;
+		_last = null;
+	}
+
+	bool empty() const { return _first == null; }
+
+	I* first() const { return static_cast<I*>(_first); }
+
+	I* last() const { return static_cast<I*>(_last); }
+
+	void push_back(I* i) {
+		listNode<I>* n = i;
+		n->_next = null;
+		n->_prev = _last;
+		if (_last)
+			_last->_next = n;
+		else
+			_first = n;
+		_last = n;
+	}
+
+	void push_front(I* i) {
+		listNode<I>* n = i;
+		n->_prev = null;
+		n->_next = _first;
+		if (_first)
+			_first->_prev = n;
+		else
+			_last = n;
+		_first = n;
+	}
+	/*
+	 *	insertAfter
+	 *
+	 *	Inserts 'i' after 'position', which must be on this list.
+	 */
+	void insertAfter(I* position, I* i) {
+		listNode<I>* p = position;
+		listNode<I>* n = i;
+		n->_prev = p;
+		n->_next = p->_next;
+		if (p->_next)
+			p->_next->_prev = n;
+		else
+			_last = n;
+		p->_next = n;
+	}
+	/*
+	 *	remove
+	 *
+	 *	Unlinks 'i', which must be on this list.
+	 */
+	void remove(I* i) {
+		listNode<I>* n = i;
+		if (n->_prev)
+			n->_prev->_next = n->_next;
+		else
+			_first = n->_next;
+		if (n->_next)
+			n->_next->_prev = n->_prev;
+		else
+			_last = n->_prev;
+	}
+
+	I* pop_front() {
+		I* i = first();
+		if (i)
+			remove(i);
+		return i;
+	}
+	/*
+	 *	splice
+	 *
+	 *	Moves every element of 'other' to the end of this list,
+	 *	leaving 'other' empty.
+	 */
+	void splice(list<I>* other) {
+		if (other->_first == null)
+			return;
+		if (_last) {
+			_last->_next = other->_first;
+			other->_first->_prev = _last;
+		} else
+			_first = other->_first;
+		_last = other->_last;
+		other->_first = null;
+		other->_last = null;
+	}
+
+private:
+	listNode<I>*	_first;
+	listNode<I>*	_last;
+};
+/*
+ *	queueNode
+ *
+ *	The link an element needs to be on a queue, used like listNode.
+ */
+template<class I>
+class queueNode {
+	friend class queue<I>;
+public:
+	I* next() const { return static_cast<I*>(_next); }
+
+protected:
+	queueNode() {
+		_next = null;
+	}
+
+private:
+	queueNode<I>*	_next;
+};
+/*
+ *	queue
+ *
+ *	An intrusive singly linked first-in, first-out queue.  Adding at
+ *	the back and taking from the front both take constant time.
+ */
+template<class I>
+class queue {
+public:
+	queue() {
+		_first = null;
+		_last = null;
+	}
+
+	bool empty() const { return _first == null; }
+
+	I* first() const { return static_cast<I*>(_first); }
+
+	void push_back(I* i) {
+		queueNode<I>* n = i;
+		n->_next = null;
+		if (_last)
+			_last->_next = n;
+		else
+			_first = n;
+		_last = n;
+	}
+	/*
+	 *	pop_front
+	 *
+	 *	RETURNS:
+	 *		The element at the front of the queue, now removed from it,
+	 *		or null if the queue is empty.
+	 */
+	I* pop_front() {
+		queueNode<I>* n = _first;
+		if (n) {
+			_first = n->_next;
+			if (_first == null)
+				_last = null;
 		}
+		return static_cast<I*>(n);
 	}
 
 private:
-	I*		_base;
+	queueNode<I>*	_first;
+	queueNode<I>*	_last;
 };
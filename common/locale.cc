@@ -1,5 +1,4 @@
 #include "../common/platform.h"
-#include <ctype.h>
 
 #include <time.h>
 #include "locale.h"
@@ -9,19 +8,13 @@ namespace locale {
 bool endsWithIgnoreCase(const string& s1, const string& s2) {
 	if (s2.size() > s1.size())
 		return false;
-	for (int i = s1.size() - s2.size(), j = 0; j < s2.size(); j++, i++)
-		if (tolower(s1[i]) != tolower(s2[j]))
-			return false;
-	return true;
+	return string::equalsIgnoreCase(s1.c_str() + s1.size() - s2.size(), s2.c_str(), s2.size());
 }
 
 bool startsWithIgnoreCase(const string& s1, const string& s2) {
 	if (s2.size() > s1.size())
 		return false;
-	for (int i = 0; i < s2.size(); i++)
-		if (tolower(s1[i]) != tolower(s2[i]))
-			return false;
-	return true;
+	return string::equalsIgnoreCase(s1.c_str(), s2.c_str(), s2.size());
 }
 
 bool toDate(const string& s, SYSTEMTIME* d) {
@@ -32,25 +25,25 @@ bool toDate(const string& s, SYSTEMTIME* d) {
 	int i = s.find('/');
 	if (i == string::npos)
 		return false;
-	d->wMonth = atoi(s.substr(0, i).c_str());
+	d->wMonth = s.slice(0, i).toInt();
 	i++;
 	int j = s.find('/', i);
 	if (j == string::npos)
 		return false;
-	d->wDay = atoi(s.substr(i, j - i).c_str());
+	d->wDay = s.slice(i, j - i).toInt();
 	j++;
 	i = s.find(' ', j);
 	if (i == string::npos)
-		d->wYear = atoi(s.substr(j).c_str());
+		d->wYear = s.slice(j).toInt();
 	else {
-		d->wYear = atoi(s.substr(j, i - j).c_str());
+		d->wYear = s.slice(j, i - j).toInt();
 		i++;
 		j = s.find(':', i);
 		if (j == string::npos)
 			return false;
-		d->wHour = atoi(s.substr(i, j - i).c_str());
+		d->wHour = s.slice(i, j - i).toInt();
 		j++;
-		d->wMinute = atoi(s.substr(j).c_str());
+		d->wMinute = s.slice(j).toInt();
 	}
 	return true;
 }
@@ -22,8 +22,6 @@ void warningMessage(const string& s) {
 		display::messageBox(null, s, "Warning", 0);
 }
 
-char string::dummy;
-
 const int OUTPUT_BLOCK = 32;
 
 void debugPrint(const string& s) {
@@ -61,8 +61,8 @@ int main(int argc, char** argv) {
 		} else if (locale::startsWithIgnoreCase(arg, "--theater=")) {
 			global::theaterFilename = arg.substr(10);
 		} else if (locale::startsWithIgnoreCase(arg, "--seed=")) {
-			printf("Random seed to %d\n", arg.substr(7).toInt());
-			global::randomSeed = arg.substr(7).toInt();
+			printf("Random seed to %d\n", arg.slice(7).toInt());
+			global::randomSeed = arg.slice(7).toInt();
 		} else if (arg == "--test") {
 			testRun = true;
 		} else if (arg == "--toe") {
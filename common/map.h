@@ -1,29 +1,362 @@
 #pragma once
 #include <crtdefs.h>
+#include <string.h>
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HASH_TABLE_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #define null 0
+/*
+ *	hashTable
+ *
+ *	Building blocks for open addressing hash tables that keep a separate
+ *	array of one byte control codes alongside their entries.  A control
+ *	byte is EMPTY, DELETED (a tombstone left behind by an erase) or, for
+ *	a full slot, the low 7 bits of the key's hash.
+ *
+ *	Slots are probed in aligned groups of GROUP_SIZE.  A single SSE2
+ *	compare checks all of the control bytes of a group against the 7
+ *	bit hash of the key being looked for, so keys are only compared for
+ *	slots that already agree in those 7 bits.  A probe ends at the first
+ *	group that contains an EMPTY slot.  Successive groups are visited in
+ *	triangular order (g, g+1, g+3, g+6, ...), which touches every group
+ *	of a power-of-two table.
+ */
+namespace hashTable {
 
-template<class A, class B>
-class map {
+typedef signed char control_t;
+
+const control_t EMPTY = -128;
+const control_t DELETED = -2;
+const int GROUP_SIZE = 16;
+
+class Group {
 public:
-	map() {
-		_entries = null;
-		clear();
+	Group(const control_t* control) {
+		_control = control;
+	}
+	/*
+	 *	match
+	 *
+	 *	RETURNS:
+	 *		A bit mask with bit i set if slot i of the group holds
+	 *		the given 7 bit hash.
+	 */
+	unsigned match(control_t h2) const {
+#ifdef HASH_TABLE_SSE2
+		__m128i c = _mm_loadu_si128((const __m128i*)_control);
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(h2)));
+#else
+		unsigned mask = 0;
+		for (int i = 0; i < GROUP_SIZE; i++)
+			if (_control[i] == h2)
+				mask |= 1 << i;
+		return mask;
+#endif
+	}
+
+	unsigned matchEmpty() const {
+		return match(EMPTY);
+	}
+	/*
+	 *	matchEmptyOrDeleted
+	 *
+	 *	Both EMPTY and DELETED are negative, while full slots are not.
+	 */
+	unsigned matchEmptyOrDeleted() const {
+#ifdef HASH_TABLE_SSE2
+		__m128i c = _mm_loadu_si128((const __m128i*)_control);
+		return _mm_movemask_epi8(c);
+#else
+		unsigned mask = 0;
+		for (int i = 0; i < GROUP_SIZE; i++)
+			if (_control[i] < 0)
+				mask |= 1 << i;
+		return mask;
+#endif
+	}
+
+private:
+	const control_t*	_control;
+};
+
+inline int lowestBit(unsigned mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#elif defined(__GNUC__)
+	return __builtin_ctz(mask);
+#else
+	int i = 0;
+	while ((mask & 1) == 0) {
+		mask >>= 1;
+		i++;
 	}
+	return i;
+#endif
+}
+/*
+ *	hashPointer
+ *
+ *	Heap pointers share their low bits (alignment) and cluster in their
+ *	high bits, so they are run through the 64 bit MurmurHash3 finalizer
+ *	to spread every input bit over the whole result.
+ */
+inline unsigned hashPointer(const void* p) {
+	unsigned long long x = (unsigned long long)(size_t)p;
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return (unsigned)x;
+}
+
+inline control_t h2(unsigned hash) {
+	return control_t(hash & 0x7f);
+}
 
-	~map() {
-		delete [] _entries;
+inline unsigned h1(unsigned hash) {
+	return hash >> 7;
+}
+
+/*
+ *	Table
+ *
+ *	The control bytes and slots of a table keyed by A*, with everything
+ *	that probes, fills, empties and rebuilds them.  Slot is a struct with
+ *	an A* member named key, followed by whatever else the table stores
+ *	for the key (map keeps its value there, hashSet nothing).  A slot
+ *	that is not in use holds a default constructed Slot.
+ */
+template<class A, class Slot>
+class Table {
+public:
+	Table() {
+		_control = null;
+		_slots = null;
+		_count = 0;
+		_deletedCount = 0;
+		_capacity = 0;
+		_growthLeft = 0;
 	}
 
+	~Table() {
+		delete [] _control;
+		delete [] _slots;
+	}
+	/*
+	 *	find
+	 *
+	 *	RETURNS:
+	 *		The slot holding 'key', or null if it is not in the table.
+	 */
+	Slot* find(A* key) const {
+		if (_capacity == 0)
+			return null;
+		unsigned hash = hashPointer(key);
+		control_t tag = h2(hash);
+		int groupMask = _capacity / GROUP_SIZE - 1;
+		int g = h1(hash) & groupMask;
+		for (int step = 1; ; step++) {
+			int base = g * GROUP_SIZE;
+			Group group(_control + base);
+			for (unsigned m = group.match(tag); m; m &= m - 1) {
+				Slot* s = &_slots[base + lowestBit(m)];
+				if (s->key == key)
+					return s;
+			}
+			if (group.matchEmpty())
+				return null;
+			g = (g + step) & groupMask;
+		}
+	}
+	/*
+	 *	add
+	 *
+	 *	Claims a slot for a key known not to be in the table.  When the
+	 *	table runs out of room it is rebuilt: at the same size if
+	 *	tombstones are taking up most of it, otherwise at twice the size.
+	 */
+	Slot* add(A* key) {
+		unsigned hash = hashPointer(key);
+		if (_capacity == 0)
+			resize(GROUP_SIZE);
+		int i = findInsertSlot(hash);
+		if (_growthLeft == 0 && _control[i] == EMPTY) {
+			if (_count < growthLimit(_capacity) / 2)
+				resize(_capacity);
+			else
+				resize(_capacity * 2);
+			i = findInsertSlot(hash);
+		}
+		if (_control[i] == EMPTY)
+			_growthLeft--;
+		else
+			_deletedCount--;
+		_control[i] = h2(hash);
+		_slots[i].key = key;
+		_count++;
+		return &_slots[i];
+	}
+	/*
+	 *	erase
+	 *
+	 *	Frees slot 's', which must be in use.  If the slot's group still
+	 *	has an EMPTY slot, no probe can have passed through the group, so
+	 *	the slot becomes EMPTY again.  Otherwise it is left as a DELETED
+	 *	tombstone until the next rehash.
+	 */
+	void erase(Slot* s) {
+		int i = int(s - _slots);
+		Group group(_control + (i & ~(GROUP_SIZE - 1)));
+		if (group.matchEmpty()) {
+			_control[i] = EMPTY;
+			_growthLeft++;
+		} else {
+			_control[i] = DELETED;
+			_deletedCount++;
+		}
+		*s = Slot();
+		_count--;
+	}
+
+	void clear() {
+		delete [] _control;
+		delete [] _slots;
+		_control = null;
+		_slots = null;
+		_count = 0;
+		_deletedCount = 0;
+		_capacity = 0;
+		_growthLeft = 0;
+	}
+	/*
+	 *	shrink_to_fit
+	 *
+	 *	Rehashes into the smallest table that will hold the current
+	 *	slots in use, dropping any tombstones.
+	 */
+	void shrink_to_fit() {
+		if (_count == 0) {
+			clear();
+			return;
+		}
+		int capacity = GROUP_SIZE;
+		while (growthLimit(capacity) < _count)
+			capacity <<= 1;
+		if (capacity < _capacity || _deletedCount)
+			resize(capacity);
+	}
+	/*
+	 *	next
+	 *
+	 *	RETURNS:
+	 *		The index of the first slot in use after 'index', or
+	 *		capacity() if there is none.  Iterators start from -1.
+	 */
+	int next(int index) const {
+		do
+			index++;
+		while (index < _capacity && _control[index] < 0);
+		return index;
+	}
+
+	Slot& slot(int index) const { return _slots[index]; }
+
+	int size() const { return _count; }
+
+	int capacity() const { return _capacity; }
+
+private:
+	static const int REHASH_SHIFT = 3;				// rehash at ((1 << REHASH_SHIFT) - 1) / (1 << REHASH_SHIFT) slots used
+
+	static int growthLimit(int capacity) {
+		return capacity - (capacity >> REHASH_SHIFT);
+	}
+	/*
+	 *	findInsertSlot
+	 *
+	 *	Returns the first EMPTY or DELETED slot along the probe
+	 *	sequence for 'hash'.
+	 */
+	int findInsertSlot(unsigned hash) const {
+		int groupMask = _capacity / GROUP_SIZE - 1;
+		int g = h1(hash) & groupMask;
+		for (int step = 1; ; step++) {
+			unsigned m = Group(_control + g * GROUP_SIZE).matchEmptyOrDeleted();
+			if (m)
+				return g * GROUP_SIZE + lowestBit(m);
+			g = (g + step) & groupMask;
+		}
+	}
+
+	void resize(int capacity) {
+		control_t* oldControl = _control;
+		Slot* oldSlots = _slots;
+		int oldCapacity = _capacity;
+
+		_control = new control_t[capacity];
+		memset(_control, EMPTY, capacity);
+		_slots = new Slot[capacity];
+		_capacity = capacity;
+		_growthLeft = growthLimit(capacity) - _count;
+		_deletedCount = 0;
+		for (int i = 0; i < oldCapacity; i++) {
+			if (oldControl[i] >= 0) {
+				unsigned hash = hashPointer(oldSlots[i].key);
+				int j = findInsertSlot(hash);
+				_control[j] = h2(hash);
+				_slots[j] = static_cast<Slot&&>(oldSlots[i]);
+			}
+		}
+		delete [] oldControl;
+		delete [] oldSlots;
+	}
+
+	control_t*	_control;
+	Slot*		_slots;
+	int			_count;
+	int			_deletedCount;		// DELETED control bytes
+	int			_capacity;			// always 0 or a power of two >= GROUP_SIZE
+	int			_growthLeft;		// EMPTY slots that may still be filled before a rehash
+};
+
+}  // namespace hashTable
+
+template<class A, class B>
+class map {
+public:
+	/*
+	 *	get
+	 *
+	 *	RETURNS:
+	 *		A pointer to the value stored for 'key'.  If there is no
+	 *		entry for the key, a pointer to a default constructed (or
+	 *		zero) value is returned.  That value must not be modified.
+	 */
 	B* get(A* key) {
-		return &findEntry(key)->value;
+		Entry* e = _table.find(key);
+		if (e)
+			return &e->value;
+		else
+			return emptyValue();
 	}
 
 	const B* get(A* key) const {
-		return &findEntry(key)->value;
+		const Entry* e = _table.find(key);
+		if (e)
+			return &e->value;
+		else
+			return emptyValue();
 	}
 
 	bool probe(A* key) const {
-		return findEntry(key)->valid;
+		return _table.find(key) != null;
 	}
 	/*
 	 *	insert
@@ -38,16 +371,10 @@ public:
 	 *		was replaced.
 	 */
 	bool put(A* key, const B& value) {
-		Entry* e = findEntry(key);
-		if (!e->valid) {
-			if (tooFull()) {
-				rehash();
-				e = findEntry(key);
-			}
-			e->valid = true;
-			e->key = key;
+		Entry* e = _table.find(key);
+		if (e == null) {
+			e = _table.add(key);
 			e->value = value;
-			_entriesCount++;
 			return true;
 		} else {
 			e->value = value;
@@ -68,61 +395,74 @@ public:
 	 *		dictionary.
 	 */
 	bool insert(A* key, const B& value) {
-		Entry* e = findEntry(key);
-		if (!e->valid) {
-			if (tooFull()) {
-				rehash();
-				e = findEntry(key);
-			}
-			e->valid = true;
-			e->key = key;
+		Entry* e = _table.find(key);
+		if (e == null) {
+			e = _table.add(key);
 			e->value = value;
-			_entriesCount++;
 			return true;
 		} else
 			return false;
 	}
+	/*
+	 *	erase
+	 *
+	 *	Removes the entry for 'key', if there is one, leaving either an
+	 *	EMPTY slot or a tombstone (see hashTable::Table::erase).
+	 *
+	 *	RETURNS:
+	 *		true - if an entry was removed.
+	 *		false - there was no entry for the key.
+	 */
+	bool erase(A* key) {
+		Entry* e = _table.find(key);
+		if (e == null)
+			return false;
+		_table.erase(e);
+		return true;
+	}
 
 	void deleteAll() {
-		for (map<A, B>::iterator i = begin(); i.valid(); i.next())
+		for (iterator i = begin(); i.valid(); i.next())
 			delete (*i);
 		clear();
 	}
 
 	void clear() {
-		delete [] _entries;
-		_entries = null;
-		_entriesCount = 0;
-		_allocatedEntries = INITIAL_TABLE_SIZE / 2;
-		rehash();
+		_table.clear();
+	}
+	/*
+	 *	shrink_to_fit
+	 *
+	 *	Rehashes into the smallest table that will hold the current
+	 *	entries, dropping any tombstones.
+	 */
+	void shrink_to_fit() {
+		_table.shrink_to_fit();
 	}
 
 	class iterator {
 		friend map;
 	public:
 		bool valid() {
-			return _index < _map->_allocatedEntries;
+			return _index < _map->_table.capacity();
 		}
 
 		void next() {
-			do
-				_index++;
-			while (_index < _map->_allocatedEntries &&
-				   !_map->_entries[_index].valid);
+			_index = _map->_table.next(_index);
 		}
 
 		B& operator* () {
-			return _map->_entries[_index].value;
+			return _map->_table.slot(_index).value;
 		}
 
 		A* key() {
-			return _map->_entries[_index].key;
+			return _map->_table.slot(_index).key;
 		}
 
 	private:
 		iterator(const map<A, B>* m) {
 			_map = m;
-			_index = 0;
+			_index = m->_table.next(-1);
 		}
 
 		int					_index;
@@ -132,79 +472,110 @@ public:
 	friend iterator;
 
 	iterator begin() const {
-		iterator i(this);
-		if (_entriesCount == 0)
-			i._index = _allocatedEntries;
-		else {
-			for (i._index = 0; i._index < _allocatedEntries; i._index++) {
-				if (_entries[i._index].valid)
-					break;
-			}
-		}
-		return i;
+		return iterator(this);
 	}
 
-	int size() const { return _entriesCount; }
+	int size() const { return _table.size(); }
 
-private:
-	static const int INITIAL_TABLE_SIZE	= 64;		// must be power of two
-	static const int REHASH_SHIFT = 3;				// rehash at ((1 << REHASH_SHIFT) - 1) / (1 << REHASH_SHIFT) keys filled
+	int capacity() const { return _table.capacity(); }
 
+private:
 	struct Entry {
 		A*		key;
 		B		value;
-		bool	valid;
 	};
 
-	Entry* findEntry(A* key) {
-		int x = (((ptrdiff_t)key) >> 4) & (_allocatedEntries - 1);
-		int startx = x;
-		for(;;) {
-			Entry* e = &_entries[x];
-			if (!e->valid || e->key == key)
-				return e;
-			x++;
-			if (x >= _allocatedEntries)
-				x = 0;
-		};
-	}
-
-	const Entry* findEntry(A* key) const {
-		int x = (((ptrdiff_t)key) >> 4) & (_allocatedEntries - 1);
-		int startx = x;
-		for(;;) {
-			Entry* e = &_entries[x];
-			if (!e->valid || e->key == key)
-				return e;
-			x++;
-			if (x >= _allocatedEntries)
-				x = 0;
-		};
-	}
-
-	bool tooFull() {
-		return _entriesCount > _rehashThreshold;
-	}
-
-	void rehash() {
-		Entry* oldE = _entries;
-		_allocatedEntries *= 2;
-		_entries = new Entry[_allocatedEntries];
-		memset(_entries, 0, _allocatedEntries * sizeof (Entry));
-		int e = _entriesCount;
-		_entriesCount = 0;
-		for (int i = 0; e > 0; i++) {
-			if (oldE[i].valid) {
-				insert(oldE[i].key, oldE[i].value);
-				e--;
-			}
+	static B* emptyValue() {
+		static B empty;
+		return &empty;
+	}
+
+	hashTable::Table<A, Entry>	_table;
+};
+/*
+ *	hashSet
+ *
+ *	A set of pointers: the same table as map, with slots that hold
+ *	only a key.
+ */
+template<class A>
+class hashSet {
+public:
+	bool probe(A* key) const {
+		return _table.find(key) != null;
+	}
+	/*
+	 *	insert
+	 *
+	 *	RETURNS:
+	 *		true - if 'key' was added.
+	 *		false - 'key' was already in the set.
+	 */
+	bool insert(A* key) {
+		if (_table.find(key) != null)
+			return false;
+		_table.add(key);
+		return true;
+	}
+	/*
+	 *	erase
+	 *
+	 *	Removes 'key', if it is in the set, the same way map::erase
+	 *	removes an entry.
+	 *
+	 *	RETURNS:
+	 *		true - if 'key' was removed.
+	 *		false - 'key' was not in the set.
+	 */
+	bool erase(A* key) {
+		Slot* s = _table.find(key);
+		if (s == null)
+			return false;
+		_table.erase(s);
+		return true;
+	}
+
+	void clear() {
+		_table.clear();
+	}
+
+	class iterator {
+		friend hashSet;
+	public:
+		bool valid() {
+			return _index < _set->_table.capacity();
 		}
-		_rehashThreshold = (_allocatedEntries * ((1 << REHASH_SHIFT) - 1)) >> REHASH_SHIFT;
-		delete [] oldE;
+
+		void next() {
+			_index = _set->_table.next(_index);
+		}
+
+		A* operator* () {
+			return _set->_table.slot(_index).key;
+		}
+
+	private:
+		iterator(const hashSet<A>* s) {
+			_set = s;
+			_index = s->_table.next(-1);
+		}
+
+		int					_index;
+		const hashSet<A>*	_set;
+	};
+
+	friend iterator;
+
+	iterator begin() const {
+		return iterator(this);
 	}
 
-	Entry*		_entries;
-	int			_entriesCount;
-	int			_allocatedEntries;
-	int			_rehashThreshold;
+	int size() const { return _table.size(); }
+
+private:
+	struct Slot {
+		A*		key;
+	};
+
+	hashTable::Table<A, Slot>	_table;
 };
@@ -0,0 +1,129 @@
+#pragma once
+#include "process.h"
+#include "vector.h"
+
+namespace process {
+
+static const int PARALLEL_SORT_THRESHOLD = 0x4000;	// smaller vectors are sorted on the calling thread
+
+template<class A, class Compare>
+class ParallelSortTask {
+public:
+	void sortRun() {
+		introsort(source, min, max, *compare);
+		done->release();
+	}
+	/*
+	 *	mergeRuns
+	 *
+	 *	Merges the sorted runs source[min, mid) and source[mid, max)
+	 *	into destination[min, max).  Ties are taken from the left run.
+	 */
+	void mergeRuns() {
+		int i = min;
+		int j = mid;
+		int k = min;
+		while (i < mid && j < max) {
+			if ((*compare)(source[j], source[i]) < 0)
+				destination[k++] = static_cast<A&&>(source[j++]);
+			else
+				destination[k++] = static_cast<A&&>(source[i++]);
+		}
+		while (i < mid)
+			destination[k++] = static_cast<A&&>(source[i++]);
+		while (j < max)
+			destination[k++] = static_cast<A&&>(source[j++]);
+		done->release();
+	}
+
+	A*				source;
+	A*				destination;
+	int				min;
+	int				mid;
+	int				max;
+	Compare*		compare;
+	Semaphore*		done;
+};
+/*
+ *	parallelSort
+ *
+ *	Sorts a vector using the threads of a ThreadPool as well as the
+ *	calling thread.  The vector is cut into one run per pool thread plus
+ *	one for the caller.  The runs are sorted concurrently and then merged
+ *	pairwise, with each round of merges also running concurrently.
+ *	Vectors shorter than PARALLEL_SORT_THRESHOLD are simply sorted on the
+ *	calling thread.
+ *
+ *	The comparison is called from several threads at once, so it must
+ *	not modify any shared state.  The caller blocks waiting for the
+ *	pool, so this must not be called from one of the pool's own threads.
+ */
+template<class A, int M, class Compare>
+void parallelSort(ThreadPool* pool, vector<A, M>* a, Compare compare) {
+	typedef ParallelSortTask<A, Compare> Task;
+
+	int n = a->size();
+	int runs = pool->threadCount() + 1;
+	if (n < PARALLEL_SORT_THRESHOLD || runs < 2) {
+		sort(a, compare);
+		return;
+	}
+	vector<int> bounds;
+	for (int i = 0; i <= runs; i++)
+		bounds.push_back(int((long long)n * i / runs));
+	vector<A> scratch(n);
+	vector<Task> tasks(runs);
+	Semaphore done(0);
+	A* from = &(*a)[0];
+	A* to = &scratch[0];
+
+	for (int i = 0; i < runs; i++) {
+		Task& t = tasks[i];
+		t.source = from;
+		t.destination = to;
+		t.min = bounds[i];
+		t.mid = bounds[i + 1];
+		t.max = bounds[i + 1];
+		t.compare = &compare;
+		t.done = &done;
+	}
+	for (int i = 1; i < runs; i++)
+		if (!pool->run(&tasks[i], &Task::sortRun))
+			tasks[i].sortRun();
+	tasks[0].sortRun();
+	for (int i = 0; i < runs; i++)
+		done.wait();
+
+	while (runs > 1) {
+		vector<int> merged;
+		int merges = 0;
+		for (int i = 0; i < runs; i += 2) {
+			Task& t = tasks[merges];
+			t.source = from;
+			t.destination = to;
+			t.min = bounds[i];
+			t.mid = bounds[i + 1];
+			t.max = i + 1 < runs ? bounds[i + 2] : bounds[i + 1];
+			merged.push_back(t.min);
+			merges++;
+		}
+		merged.push_back(n);
+		for (int i = 1; i < merges; i++)
+			if (!pool->run(&tasks[i], &Task::mergeRuns))
+				tasks[i].mergeRuns();
+		tasks[0].mergeRuns();
+		for (int i = 0; i < merges; i++)
+			done.wait();
+		A* x = from;
+		from = to;
+		to = x;
+		bounds = merged;
+		runs = merges;
+	}
+	if (from != &(*a)[0]) {
+		for (int i = 0; i < n; i++)
+			(*a)[i] = static_cast<A&&>(from[i]);
+	}
+}
+
+}  // namespace process
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include "atom.h"
+#include "concurrent_dictionary.h"
 #include "file_system.h"
 #include "internal.h"
 #include "process.h"
@@ -10,7 +11,7 @@
 
 namespace script {
 
-static dictionary<Object* (*)()>	factories;
+static concurrentDictionary<Object* (*)()>	factories;
 
 class ScannerMessageLog : public MessageLog {
 public:
@@ -161,10 +162,10 @@ void Parser::parseGroup(Object* parent, Token terminator) {
 void Parser::parseObject(Object* parent, const char* tagStart, int tagLength) {
 	Object* object;
 	string tag(tagStart, tagLength);
-	Object* (*const*factory)();// = _factories.get(tag);
-//	if (*factory == null)
+	Object* (*factory)();// = *_factories.get(tag);
+//	if (factory == null)
 		factory = factories.get(tag);
-	if (*factory == null)
+	if (factory == null)
 		object = new Object();
 	else
 		object = (*factory)();
@@ -190,7 +191,7 @@ void Parser::parseObject(Object* parent, const char* tagStart, int tagLength) {
 		}
 		string attribute = string(_scanner.tokenText(), _scanner.tokenSize());
 		if (_scanner.next() == COLON) {
-			vector<Atom*> value;
+			smallVector<Atom*, 4> value;
 			vector<Atom*>* outer = _atoms;
 			_atoms = &value;
 			parseGroup(null, COMMA);
@@ -88,7 +88,6 @@ DWORD WINAPI Thread::threadProc(void* data) {
 }
 
 ThreadPool::ThreadPool(int threadCount) : _actionQueue(0) {
-	_actions = null;
 	_idleThreads = 0;
 	_waitingThreads = 0;
 	_shutdownSemaphore = null;
@@ -132,17 +131,14 @@ bool ThreadPool::busy() {
 	if (_idleThreads != _threads.size())
 		return true;
 	else
-		return _actions != null;
+		return !_actions.empty();
 }
 
 void ThreadPool::flushActions() {
 	MutexLock m(&_lock);
 
-	while (_actions != null) {
-		Handler* a = _actions;
-		_actions = a->next;
-		delete a;
-	}
+	while (!_actions.empty())
+		delete _actions.pop_front();
 }
 
 bool ThreadPool::runOne(WaitableEvent* interruptWhen) {
@@ -150,7 +146,7 @@ bool ThreadPool::runOne(WaitableEvent* interruptWhen) {
 		MutexLock m(&_lock);
 
 		_waitingThreads++;
-		if (_idleThreads + _waitingThreads == _threads.size() && _actions == null) {
+		if (_idleThreads + _waitingThreads == _threads.size() && _actions.empty()) {
 			_waitingThreads--;
 			return false;
 		}
@@ -175,17 +171,7 @@ bool ThreadPool::enqueue(Handler* h, bool duringShutdown) {
 
 		if (_shutdownSemaphore && !duringShutdown)
 			return false;
-		h->next = null;
-		if (_actions == null)
-			_actions = h;
-		else {
-			for (Handler* last = _actions; ; last = last->next) {
-				if (last->next == null) {
-					last->next = h;
-					break;
-				}
-			}
-		}
+		_actions.push_back(h);
 	}
 	_actionQueue.release();
 	return true;
@@ -202,7 +188,7 @@ ThreadPool::Handler* ThreadPool::dequeue() {
 		// may be transient.  The usage of the thread pool will determine
 		// whether an 'idle' event represents a permanent or transient
 		// condition.
-		if (_idleThreads == _threads.size() && _actions == null)
+		if (_idleThreads == _threads.size() && _actions.empty())
 			idle.fire();
 	}
 	return takeOne();
@@ -216,10 +202,7 @@ ThreadPool::Handler* ThreadPool::takeOne(WaitableEvent* interruptWhen) {
 		_idleThreads--;
 		if (result == 1)
 			return null;
-		Handler* h = _actions;
-		if (h)
-			_actions = h->next;
-		return h;
+		return _actions.pop_front();
 	}
 }
 
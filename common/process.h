@@ -1,6 +1,7 @@
 #pragma once
 #include <windows.h>
 #include "event.h"
+#include "list.h"
 #include "string.h"
 #include "vector.h"
 
@@ -213,7 +214,7 @@ private:
 	HANDLE			_hThread;
 	Handler*		_handler;
 	int				_local;
-	vector<void*>	_locals;
+	smallVector<void*, 4>	_locals;
 };
 
 class Mutex {
@@ -366,12 +367,12 @@ public:
 
 	int idleThreads() const { return _idleThreads; }
 
+	int threadCount() const { return _threads.size(); }
+
 private:
-	class Handler {
+	class Handler : public queueNode<Handler> {
 	public:
 		virtual void run() = 0;
-
-		class Handler*		next;
 	};
 
 	class FunctionHandler : public Handler {
@@ -437,7 +438,7 @@ private:
 	Semaphore				_actionQueue;
 	Mutex					_lock;
 	vector<Thread*>			_threads;
-	Handler*				_actions;			// guarded by _lock
+	queue<Handler>			_actions;			// guarded by _lock
 	int						_idleThreads;		// guarded by _lock
 	Semaphore*				_shutdownSemaphore;	// guarded by _lock
 	int						_waitingThreads;
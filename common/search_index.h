@@ -0,0 +1,190 @@
+#pragma once
+#include "map.h"
+#include "vector.h"
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SEARCH_INDEX_SSE2
+#endif
+/*
+ *	searchIndex
+ *
+ *	A read-only copy of a sorted array of keys, laid out for fast
+ *	searching.  Keys are compared with <, so K is a number or a class
+ *	that defines operator <.
+ *
+ *	The keys are stored in Eytzinger (breadth first) order: the root of
+ *	the implicit search tree at position 1, and the children of
+ *	position k at 2k and 2k + 1.  A search walks down from the root with
+ *	no data dependent branches, and the first few levels, which every
+ *	search visits, share a handful of cache lines.  While at position k
+ *	the search prefetches the cache line holding its descendants four
+ *	levels down.
+ *
+ *	The index does not follow changes to the array it was built from;
+ *	it must be built again after any change.
+ */
+template<class K>
+class searchIndex {
+public:
+	searchIndex() {
+		_keys = null;
+		_ranks = null;
+		_size = 0;
+	}
+
+	searchIndex(const searchIndex<K>& source) {
+		_keys = null;
+		_ranks = null;
+		_size = 0;
+		copyFrom(source);
+	}
+
+	~searchIndex() {
+		clear();
+	}
+
+	searchIndex<K>& operator= (const searchIndex<K>& source) {
+		if (this != &source) {
+			clear();
+			copyFrom(source);
+		}
+		return *this;
+	}
+	/*
+	 *	build
+	 *
+	 *	Builds the index from the 'count' keys at 'sorted', which must
+	 *	be in ascending order.
+	 */
+	void build(const K* sorted, int count) {
+		clear();
+		_size = count;
+		_keys = new K[count + 1];
+		_ranks = new int[count + 1];
+		_ranks[0] = count;
+		int next = 0;
+		fill(sorted, &next, 1);
+	}
+
+	void build(const vector<K>& sorted) {
+		build(sorted.size() ? &sorted[0] : null, sorted.size());
+	}
+	/*
+	 *	lowerBound
+	 *
+	 *	RETURNS:
+	 *		The position in the sorted array of the first key not less
+	 *		than 'key', or size() if there is none.
+	 */
+	int lowerBound(const K& key) const {
+		unsigned k = 1;
+		while (k <= (unsigned)_size) {
+			prefetch(k);
+			k = 2 * k + (_keys[k] < key);
+		}
+		return _ranks[settle(k)];
+	}
+	/*
+	 *	upperBound
+	 *
+	 *	RETURNS:
+	 *		The position in the sorted array of the first key greater
+	 *		than 'key', or size() if there is none.
+	 */
+	int upperBound(const K& key) const {
+		unsigned k = 1;
+		while (k <= (unsigned)_size) {
+			prefetch(k);
+			k = 2 * k + !(key < _keys[k]);
+		}
+		return _ranks[settle(k)];
+	}
+	/*
+	 *	lowerBound
+	 *
+	 *	Looks up 'count' keys at once, storing lowerBound(keys[i]) in
+	 *	output[i].  Up to BATCH searches advance a level at a time
+	 *	together, so the cache misses of one overlap those of the others.
+	 */
+	void lowerBound(const K* keys, int count, int* output) const {
+		static const int BATCH = 8;
+		unsigned k[BATCH];
+		for (int base = 0; base < count; base += BATCH) {
+			int n = count - base < BATCH ? count - base : BATCH;
+			for (int j = 0; j < n; j++)
+				k[j] = 1;
+			for (bool active = _size > 0; active; ) {
+				active = false;
+				for (int j = 0; j < n; j++) {
+					if (k[j] <= (unsigned)_size) {
+						prefetch(k[j]);
+						k[j] = 2 * k[j] + (_keys[k[j]] < keys[base + j]);
+						active = true;
+					}
+				}
+			}
+			for (int j = 0; j < n; j++)
+				output[base + j] = _ranks[settle(k[j])];
+		}
+	}
+
+	void clear() {
+		delete [] _keys;
+		delete [] _ranks;
+		_keys = null;
+		_ranks = null;
+		_size = 0;
+	}
+
+	int size() const { return _size; }
+
+private:
+	void copyFrom(const searchIndex<K>& source) {
+		if (source._keys == null)
+			return;
+		_size = source._size;
+		_keys = new K[_size + 1];
+		_ranks = new int[_size + 1];
+		_ranks[0] = _size;
+		for (int k = 1; k <= _size; k++) {
+			_keys[k] = source._keys[k];
+			_ranks[k] = source._ranks[k];
+		}
+	}
+	/*
+	 *	fill
+	 *
+	 *	An in-order walk of the implicit tree visits positions in key
+	 *	order, so it places the sorted keys one after another.
+	 */
+	void fill(const K* sorted, int* next, unsigned k) {
+		if (k > (unsigned)_size)
+			return;
+		fill(sorted, next, 2 * k);
+		_keys[k] = sorted[*next];
+		_ranks[k] = *next;
+		(*next)++;
+		fill(sorted, next, 2 * k + 1);
+	}
+	/*
+	 *	settle
+	 *
+	 *	A search ends below a leaf, having gone right at every node
+	 *	whose key was too small.  Undoing those right turns, and then
+	 *	the final left turn, yields the answer: the last node at which
+	 *	the search went left, or 0 (rank size()) if it never did.
+	 */
+	static unsigned settle(unsigned k) {
+		return k >> (hashTable::lowestBit(~k) + 1);
+	}
+
+	void prefetch(unsigned k) const {
+#ifdef SEARCH_INDEX_SSE2
+		_mm_prefetch((const char*)_keys + (size_t)k * 16 * sizeof (K), _MM_HINT_T0);
+#endif
+	}
+
+	K*			_keys;			// _keys[1.._size] in Eytzinger order
+	int*		_ranks;			// _ranks[k] is the sorted position of _keys[k]
+	int			_size;
+};
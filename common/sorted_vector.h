@@ -0,0 +1,153 @@
+#pragma once
+#include "vector.h"
+/*
+ *	sortedVector
+ *
+ *	A vector whose elements are kept in the order defined by their
+ *	compare method.  It serves as a flat ordered map when the elements
+ *	carry both a key and a value (the key deciding compare).
+ *
+ *	Elements may be added one at a time with insert, which finds their
+ *	place by binary search, or in bulk with append, which just adds
+ *	them at the end.  Appended elements are sorted into place the next
+ *	time the vector is read, with one sort for the whole batch, so a
+ *	table of n elements is loaded in O(n log n) rather than O(n^2).
+ *	Either way, elements that compare equal stay in the order they
+ *	were added.
+ *
+ *	Searches take a key object whose compare method orders the key
+ *	against an element, as for binarySearch.  A range of elements is
+ *	read by index, from lowerBound to upperBound.
+ */
+template<class A>
+class sortedVector {
+public:
+	sortedVector() {
+		_sortedCount = 0;
+	}
+
+	void insert(const A& a) {
+		int i = upperBound(a);
+		_elements.insert(i, a);
+		_sortedCount++;
+	}
+
+	void append(const A& a) {
+		_elements.push_back(a);
+	}
+	/*
+	 *	lowerBound
+	 *
+	 *	RETURNS:
+	 *		The index of the first element not less than 'key', or
+	 *		size() if there is none.
+	 */
+	template<class Key>
+	int lowerBound(const Key& key) const {
+		settle();
+		int min = 0;
+		int max = _elements.size();
+		while (min < max) {
+			int mid = (min + max) >> 1;
+			if (key.compare(_elements[mid]) > 0)
+				min = mid + 1;
+			else
+				max = mid;
+		}
+		return min;
+	}
+	/*
+	 *	upperBound
+	 *
+	 *	RETURNS:
+	 *		The index of the first element greater than 'key', or
+	 *		size() if there is none.
+	 */
+	template<class Key>
+	int upperBound(const Key& key) const {
+		settle();
+		int min = 0;
+		int max = _elements.size();
+		while (min < max) {
+			int mid = (min + max) >> 1;
+			if (key.compare(_elements[mid]) >= 0)
+				min = mid + 1;
+			else
+				max = mid;
+		}
+		return min;
+	}
+	/*
+	 *	find
+	 *
+	 *	RETURNS:
+	 *		The index of the first element equal to 'key', or -1 if
+	 *		there is none.
+	 */
+	template<class Key>
+	int find(const Key& key) const {
+		int i = lowerBound(key);
+		if (i < _elements.size() && key.compare(_elements[i]) == 0)
+			return i;
+		else
+			return -1;
+	}
+
+	void remove(int i, int count = 1) {
+		settle();
+		_elements.remove(i, count);
+		_sortedCount = _elements.size();
+	}
+
+	void clear() {
+		_elements.clear();
+		_sortedCount = 0;
+	}
+
+	void reserve(int length) {
+		_elements.reserve(length);
+	}
+
+	const A& operator [] (int i) const {
+		settle();
+		return _elements[i];
+	}
+
+	int size() const { return _elements.size(); }
+
+	const vector<A>& elements() const {
+		settle();
+		return _elements;
+	}
+
+private:
+	class Order {
+	public:
+		int operator () (const A& x, const A& y) const {
+			return x.compare(y);
+		}
+	};
+	/*
+	 *	settle
+	 *
+	 *	Sorts any appended elements and merges them with the sorted
+	 *	ones.  The appended elements are sorted on their own first, so
+	 *	a small batch added to a large table costs little more than
+	 *	one pass over the table.
+	 */
+	void settle() const {
+		int n = _elements.size();
+		if (_sortedCount == n)
+			return;
+		A* a = &_elements[0];
+		A* scratch = new A[n];
+		Order order;
+		mergeSort(a, _sortedCount, n, scratch, order);
+		mergeRuns(a, 0, _sortedCount, n, scratch, order);
+		delete [] scratch;
+		_sortedCount = n;
+	}
+
+	mutable vector<A>	_elements;
+	mutable int			_sortedCount;		// elements [0, _sortedCount) are in order
+};
@@ -2,14 +2,22 @@
 #include "string.h"
 
 #include <ctype.h>
+#include <math.h>
 #include <stdarg.h>
 #include <time.h>
-#include "xml.h"
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define STRING_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 string operator+ (const char* left, const string& right) {
 	string s(left);
 
-	return s + right;
+	s.append(right);
+	return s;
 }
 
 bool string::beginsWith(const string& prefix) const {
@@ -17,7 +25,7 @@ bool string::beginsWith(const string& prefix) const {
 		return false;
 	if (prefix.size() == 0)
 		return false;
-	return memcmp(prefix._contents->data, _contents->data, prefix._contents->length) == 0;
+	return memcmp(prefix.c_str(), c_str(), prefix.size()) == 0;
 }
 
 bool string::endsWith(const string& suffix) const {
@@ -25,19 +33,20 @@ bool string::endsWith(const string& suffix) const {
 		return false;
 	if (suffix.size() == 0)
 		return false;
-	return strcmp(suffix._contents->data, &_contents->data[_contents->length - suffix._contents->length]) == 0;
+	return strcmp(suffix.c_str(), c_str() + size() - suffix.size()) == 0;
 }
 
 unsigned string::asHex() const {
 	int i = 0;
 	int length = size();
+	const char* text = c_str();
 	if (length > 2){
-		if (_contents->data[0] == '0' && (_contents->data[1] == 'x' || _contents->data[1] == 'X'))
+		if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
 			i += 2;
 	}
 	int v = 0;
 	while (i < length){
-		char c = _contents->data[i];
+		char c = text[i];
 		if (c >= '0' && c <= '9')
 			v = v * 16 + (unsigned(c) - unsigned('0'));
 		else if (c >= 'a' && c <= 'f')
@@ -52,60 +61,172 @@ unsigned string::asHex() const {
 }
 
 void string::resize(int length) {
-	int new_size;
-	if (_contents) {
-		if (_contents->length >= length) {
-			if (length == 0)
-				clear();
-			else
-				_contents->length = length;
+	if (_short.length != ON_HEAP) {
+		if (length <= SHORT_CAPACITY) {
+			_short.length = length;
+			_short.text[length] = 0;
 			return;
 		}
+		allocation* a = (allocation*)malloc(reserved_size(length));
+		memcpy(a->data, _short.text, _short.length);
+		a->length = length;
+		a->hash = UNHASHED;
+		a->data[length] = 0;
+		_contents = a;
+		_short.length = ON_HEAP;
+		return;
+	}
+	if (length == 0) {
+		clear();
+		return;
+	}
+	if (_contents->length < length) {
 		int old_size = reserved_size(_contents->length);
-		new_size = reserved_size(length);
-		if (old_size == new_size) {
-			_contents->length = length;
-			return;
-		}
-	} else {
-		if (length == 0)
-			return;
-		new_size = reserved_size(length);
+		int new_size = reserved_size(length);
+		if (old_size != new_size)
+			_contents = (allocation*)realloc(_contents, new_size);
 	}
-	allocation* a = (allocation*)malloc(new_size);
-	if (_contents) {
-		memcpy(a->data, _contents->data, _contents->length + 1);
-		free(_contents);
+	_contents->length = length;
+	_contents->hash = UNHASHED;
+	_contents->data[length] = 0;
+}
+
+static inline int firstSetBit(unsigned mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#elif defined(__GNUC__)
+	return __builtin_ctz(mask);
+#else
+	int i = 0;
+	while ((mask & 1) == 0) {
+		mask >>= 1;
+		i++;
 	}
-	a->length = length;
-	a->data[length] = 0;
-	_contents = a;
+	return i;
+#endif
 }
 
-string string::tolower() const {
-	if (_contents) {
-		string result;
+static inline char lowerAscii(char c) {
+	if (c >= 'A' && c <= 'Z')
+		return c + ('a' - 'A');
+	else
+		return c;
+}
+/*
+ *	toggleCase
+ *
+ *	Copies 'length' bytes from 'in' to 'out', flipping the 0x20 (case)
+ *	bit of those between 'first' and 'last', which must both be letters
+ *	of the same case.
+ */
+static void toggleCase(char* out, const char* in, int length, char first, char last) {
+	int i = 0;
+#ifdef STRING_SSE2
+	__m128i below = _mm_set1_epi8(first - 1);
+	__m128i above = _mm_set1_epi8(last + 1);
+	__m128i caseBit = _mm_set1_epi8(0x20);
+	for (; i + 16 <= length; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i letters = _mm_and_si128(_mm_cmpgt_epi8(x, below), _mm_cmplt_epi8(x, above));
+		_mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(x, _mm_and_si128(letters, caseBit)));
+	}
+#endif
+	for (; i < length; i++) {
+		char c = in[i];
+		if (c >= first && c <= last)
+			c ^= 0x20;
+		out[i] = c;
+	}
+}
 
-		char* out = result.buffer_(_contents->length);
-		for (int i = 0; i < _contents->length; i++)
-			out[i] = ::tolower(_contents->data[i]);
-		return result;
-	} else
-		return string();
+string string::toLowerAscii() const {
+	string result;
+
+	int length = size();
+	toggleCase(result.buffer_(length), c_str(), length, 'A', 'Z');
+	return result;
+}
+
+string string::toUpperAscii() const {
+	string result;
+
+	int length = size();
+	toggleCase(result.buffer_(length), c_str(), length, 'a', 'z');
+	return result;
+}
+/*
+ *	firstCaseDifference
+ *
+ *	RETURNS:
+ *		The first offset below 'length' where the bytes at 'a' and 'b'
+ *		differ after mapping to lower case, or 'length' if none do.
+ */
+static int firstCaseDifference(const char* a, const char* b, int length) {
+	int i = 0;
+#ifdef STRING_SSE2
+	__m128i below = _mm_set1_epi8('A' - 1);
+	__m128i above = _mm_set1_epi8('Z' + 1);
+	__m128i caseBit = _mm_set1_epi8(0x20);
+	for (; i + 16 <= length; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+		x = _mm_or_si128(x, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(x, below),
+														_mm_cmplt_epi8(x, above)), caseBit));
+		y = _mm_or_si128(y, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(y, below),
+														_mm_cmplt_epi8(y, above)), caseBit));
+		unsigned differ = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+		if (differ)
+			return i + firstSetBit(differ);
+	}
+#endif
+	for (; i < length; i++)
+		if (lowerAscii(a[i]) != lowerAscii(b[i]))
+			return i;
+	return length;
+}
+
+bool string::equalsIgnoreCase(const char* a, const char* b, int length) {
+	return firstCaseDifference(a, b, length) == length;
+}
+
+int string::compareIgnoreCase(const char* a, const char* b, int length) {
+	int i = firstCaseDifference(a, b, length);
+	if (i == length)
+		return 0;
+	else
+		return (unsigned char)lowerAscii(a[i]) - (unsigned char)lowerAscii(b[i]);
+}
+
+int string::compareIgnoreCase(const string& s2) const {
+	int n;
+
+	if (size() < s2.size())
+		n = size();
+	else
+		n = s2.size();
+	int r = compareIgnoreCase(c_str(), s2.c_str(), n);
+	if (r != 0)
+		return r;
+	else
+		return size() - s2.size();
 }
 
 void string::split(char delimiter, vector<string>* output) const {
 	output->resize(0);
-	if (_contents) {
+	int length = size();
+	if (length) {
+		const char* text = c_str();
 		int tokenStart = 0;
-		for (int i = 0; i < _contents->length; i++) {
-			if (_contents->data[i] == delimiter) {
-				output->push_back(string(_contents->data + tokenStart, i - tokenStart));
+		for (int i = 0; i < length; i++) {
+			if (text[i] == delimiter) {
+				output->push_back(string(text + tokenStart, i - tokenStart));
 				tokenStart = i + 1;
 			}
 		}
 		if (tokenStart > 0)
-			output->push_back(string(_contents->data + tokenStart, _contents->length - tokenStart));
+			output->push_back(string(text + tokenStart, length - tokenStart));
 		else
 			output->push_back(*this);
 	} else
@@ -132,50 +253,85 @@ int skipFormat(const char* format, int i) {
 	}
 }
 
+/*
+ *	printf
+ *
+ *	Each conversion is handled separately.  A bare %d, %u, %s, %c or %%
+ *	is formatted directly; anything with flags, a width or a precision,
+ *	and any other conversion, is handed to sprintf with just its own
+ *	argument.
+ */
 int string::printf(const char* format, ...) {
 	va_list ap;
 	va_start(ap, format);
 	int originalSize = size();
 	char buffer[128];
+	char spec[32];
 	for (int i = 0; format[i]; i++) {
 		if (format[i] == '%') {
-			string a;
 			const char* fmt = &format[i];
 			i = skipFormat(format, i + 1);
+			bool bare = fmt + 1 == &format[i];
+			int specLength = 1 + (int)(&format[i] - fmt);
+			if (specLength >= (int)sizeof spec)
+				specLength = sizeof spec - 1;
+			memcpy(spec, fmt, specLength);
+			spec[specLength] = 0;
 			switch (format[i]) {
 			case 0:
 				va_end(ap);
 				return size() - originalSize;
-			case	'c':
+
 			case	'd':
-			case	'o':
-			case	'p':
+				if (bare)
+					append(buffer, number::format(buffer, va_arg(ap, int)));
+				else {
+					sprintf(buffer, spec, va_arg(ap, int));
+					append(buffer);
+				}
+				break;
+
 			case	'u':
+				if (bare)
+					append(buffer, number::format(buffer, va_arg(ap, unsigned)));
+				else {
+					sprintf(buffer, spec, va_arg(ap, unsigned));
+					append(buffer);
+				}
+				break;
+
+			case	'c':
+				if (bare)
+					push_back((char)va_arg(ap, int));
+				else {
+					sprintf(buffer, spec, va_arg(ap, int));
+					append(buffer);
+				}
+				break;
+
+			case	'o':
 			case	'x':
-				a = string(fmt, 1 + &format[i] - fmt);
-				vsprintf(buffer, a.c_str(), ap);
-				va_arg(ap, int);
+			default:
+				sprintf(buffer, spec, va_arg(ap, int));
+				append(buffer);
+				break;
+
+			case	'p':
+				sprintf(buffer, spec, va_arg(ap, void*));
 				append(buffer);
 				break;
 
 			case	'e':
 			case	'f':
 			case	'g':
-				a = string(fmt, 1 + &format[i] - fmt);
-				vsprintf(buffer, a.c_str(), ap);
-				va_arg(ap, double);
+				sprintf(buffer, spec, va_arg(ap, double));
 				append(buffer);
 				break;
 
-			default:
-				a = string(fmt, 1 + &format[i] - fmt);
-				vsprintf(buffer, a.c_str(), ap);
-				va_arg(ap, int);
-				append(buffer);
-				break;
 			case 's':
 				append(va_arg(ap, char*));
 				break;
+
 			case	'%':
 				push_back('%');
 				break;
@@ -213,27 +369,104 @@ int string::universalTime(time_t t, const char* format) {
 	return result;
 }
 
-string string::escapeC() {
-	string output;
+static inline bool isCSpecial(char c) {
+	unsigned char u = c;
+	return u < 0x20 || u >= 0x7f || u == '\\';
+}
+/*
+ *	findCSpecial
+ *
+ *	RETURNS:
+ *		The offset of the first byte in 'text' that escapeC must
+ *		escape, or 'length' if there is none.
+ */
+static int findCSpecial(const char* text, int length) {
+	int i = 0;
+#ifdef STRING_SSE2
+	__m128i space = _mm_set1_epi8(0x20);
+	__m128i del = _mm_set1_epi8(0x7f);
+	__m128i backslash = _mm_set1_epi8('\\');
+	for (; i + 16 <= length; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(text + i));
+		// Signed, bytes from 0x80 up are below 0x20 too
+		__m128i special = _mm_or_si128(_mm_cmplt_epi8(x, space),
+									   _mm_or_si128(_mm_cmpeq_epi8(x, del),
+													_mm_cmpeq_epi8(x, backslash)));
+		unsigned mask = _mm_movemask_epi8(special);
+		if (mask)
+			return i + firstSetBit(mask);
+	}
+#endif
+	for (; i < length; i++)
+		if (isCSpecial(text[i]))
+			return i;
+	return length;
+}
 
-	if (size() == 0)
-		return output;
-	for (int i = 0; i < _contents->length; i++) {
-		switch (_contents->data[i]) {
-		case	'\\':	output.printf("\\\\");	break;
-		case	'\a':	output.printf("\\a");	break;
-		case	'\b':	output.printf("\\b");	break;
-		case	'\f':	output.printf("\\f");	break;
-		case	'\n':	output.printf("\\n");	break;
-		case	'\r':	output.printf("\\r");	break;
-		case	'\v':	output.printf("\\v");	break;
-		default:
-			if (_contents->data[i] >= 0x20 &&
-				_contents->data[i] < 0x7f)
-				output.push_back(_contents->data[i]);
-			else
-				output.printf("\\x%x", _contents->data[i] & 0xff);
-		}
+static const char* cEscapeLetter(char c) {
+	switch (c) {
+	case	'\\':	return "\\\\";
+	case	'\a':	return "\\a";
+	case	'\b':	return "\\b";
+	case	'\f':	return "\\f";
+	case	'\n':	return "\\n";
+	case	'\r':	return "\\r";
+	case	'\v':	return "\\v";
+	default:		return null;
+	}
+}
+
+static const char hexDigits[] = "0123456789abcdef";
+/*
+ *	writeCEscape
+ *
+ *	Writes the escape sequence for the special byte 'c' at 'output',
+ *	or if 'output' is null, just measures it.
+ *
+ *	RETURNS:
+ *		The length of the escape sequence.
+ */
+static int writeCEscape(char* output, char c) {
+	const char* letter = cEscapeLetter(c);
+	if (letter) {
+		if (output)
+			memcpy(output, letter, 2);
+		return 2;
+	}
+	unsigned u = c & 0xff;
+	int n = u < 0x10 ? 3 : 4;
+	if (output) {
+		output[0] = '\\';
+		output[1] = 'x';
+		if (n == 4)
+			output[2] = hexDigits[u >> 4];
+		output[n - 1] = hexDigits[u & 0xf];
+	}
+	return n;
+}
+
+string string::escapeC() const {
+	int length = size();
+	const char* text = c_str();
+	int i = findCSpecial(text, length);
+	if (i == length)
+		return *this;
+
+	int outputLength = length;
+	for (int j = i; j < length; j += 1 + findCSpecial(text + j + 1, length - j - 1))
+		outputLength += writeCEscape(null, text[j]) - 1;
+
+	string output;
+	char* out = output.buffer_(outputLength);
+	memcpy(out, text, i);
+	out += i;
+	while (i < length) {
+		out += writeCEscape(out, text[i]);
+		i++;
+		int clean = findCSpecial(text + i, length - i);
+		memcpy(out, text + i, clean);
+		out += clean;
+		i += clean;
 	}
 	return output;
 }
@@ -242,68 +475,99 @@ static inline bool isoctal(char x) {
 	return x >= '0' && x <= '7';
 }
 
-bool string::unescapeC(string* output) {
-	output->clear();
-	if (size() == 0)
+static inline int hexDigitValue(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	else if (c >= 'a' && c <= 'f')
+		return 10 + c - 'a';
+	else if (c >= 'A' && c <= 'F')
+		return 10 + c - 'A';
+	else
+		return -1;
+}
+/*
+ *	unescapeC
+ *
+ *	Unescaping never lengthens the text, so the output is sized to the
+ *	input once and the runs between backslashes are copied in bulk.
+ */
+bool string::unescapeC(string* output) const {
+	int length = size();
+	const char* text = c_str();
+	const char* cp = (const char*)memchr(text, '\\', length);
+	if (cp == null) {
+		*output = *this;
 		return true;
-	for (int i = 0; i < _contents->length; i++) {
-		if (_contents->data[i] == '\\') {
-			if (i == _contents->length - 1)
+	}
+	output->clear();
+	char* out = output->buffer_(length);
+	int o = (int)(cp - text);
+	memcpy(out, text, o);
+	int i = o;
+	while (i < length) {
+		// text[i] is a backslash
+		i++;
+		if (i >= length) {
+			output->resize(o);
+			return false;
+		}
+		int v;
+		switch (text[i]) {
+		case 'a':	out[o++] = '\a';	i++;	break;
+		case 'b':	out[o++] = '\b';	i++;	break;
+		case 'f':	out[o++] = '\f';	i++;	break;
+		case 'n':	out[o++] = '\n';	i++;	break;
+		case 'r':	out[o++] = '\r';	i++;	break;
+		case 't':	out[o++] = '\t';	i++;	break;
+		case 'v':	out[o++] = '\v';	i++;	break;
+		case 'x':
+		case 'X':
+			i++;
+			if (i >= length || hexDigitValue(text[i]) < 0) {
+				output->resize(o);
 				return false;
-			else {
-				int v;
-				i++;
-				switch (_contents->data[i]) {
-				case 'a':	output->push_back('\a');	break;
-				case 'b':	output->push_back('\b');	break;
-				case 'f':	output->push_back('\f');	break;
-				case 'n':	output->push_back('\n');	break;
-				case 'r':	output->push_back('\r');	break;
-				case 't':	output->push_back('\t');	break;
-				case 'v':	output->push_back('\v');	break;
-				case 'x':
-				case 'X':
-					i++;;
-					if (i >= _contents->length)
-						return false;
-					if (!isxdigit(_contents->data[i]))
-						return false;
-					v = 0;
-					do {
-						v <<= 4;
-						if (v > 0xff)
-							return false;
-						if (isdigit(_contents->data[i]))
-							v += _contents->data[i] - '0';
-						else
-							v += 10 + ::tolower(_contents->data[i]) - 'a';
-						i++;
-					} while (i < _contents->length && isxdigit(_contents->data[i]));
-					output->push_back(v);
-					break;
-				case '0':
-					i++;
-					if (i >= _contents->length)
-						return false;
-					if (!isoctal(_contents->data[i]))
-						return false;
-					v = 0;
-					do {
-						v <<= 3;
-						if (v > 0xff)
-							return false;
-						v += _contents->data[i] - '0';
-						i++;
-					} while (i < _contents->length && isoctal(_contents->data[i]));
-					output->push_back(v);
-					break;
-				default:	
-					output->push_back(_contents->data[i]);
+			}
+			v = 0;
+			do {
+				v = (v << 4) + hexDigitValue(text[i]);
+				if (v > 0xff) {
+					output->resize(o);
+					return false;
 				}
+				i++;
+			} while (i < length && hexDigitValue(text[i]) >= 0);
+			out[o++] = v;
+			break;
+
+		case '0':
+			i++;
+			if (i >= length || !isoctal(text[i])) {
+				output->resize(o);
+				return false;
 			}
-		} else
-			output->push_back(_contents->data[i]);
+			v = 0;
+			do {
+				v = (v << 3) + text[i] - '0';
+				if (v > 0xff) {
+					output->resize(o);
+					return false;
+				}
+				i++;
+			} while (i < length && isoctal(text[i]));
+			out[o++] = v;
+			break;
+
+		default:	
+			out[o++] = text[i];
+			i++;
+		}
+		cp = (const char*)memchr(text + i, '\\', length - i);
+		int clean = cp ? (int)(cp - (text + i)) : length - i;
+		memcpy(out + o, text + i, clean);
+		o += clean;
+		i += clean;
 	}
+	output->resize(o);
 	return true;
 }
 
@@ -313,45 +577,63 @@ string string::trim() const {
 
 	int prefix;
 	int suffix;
-	for (prefix = 0; prefix < _contents->length; prefix++)
-		if (!isspace(_contents->data[prefix]))
+	const char* text = c_str();
+	for (prefix = 0; prefix < size(); prefix++)
+		if (!isspace(text[prefix]))
 			break;
-	for (suffix = _contents->length; suffix > prefix; suffix--)
-		if (!isspace(_contents->data[suffix - 1]))
+	for (suffix = size(); suffix > prefix; suffix--)
+		if (!isspace(text[suffix - 1]))
 			break;
 	return substr(prefix, suffix - prefix);
 }
 
+stringSlice stringSlice::trim() const {
+	int prefix;
+	int suffix;
+	for (prefix = 0; prefix < _length; prefix++)
+		if (!isspace(_text[prefix]))
+			break;
+	for (suffix = _length; suffix > prefix; suffix--)
+		if (!isspace(_text[suffix - 1]))
+			break;
+	return stringSlice(_text + prefix, suffix - prefix);
+}
+int stringSlice::toInt() const {
+	int v;
+	number::parse(_text, _length, &v);
+	return v;
+}
+
+double stringSlice::toDouble() const {
+	double x;
+	number::parse(_text, _length, &x);
+	return x;
+}
+
 int string::toInt() const {
-	if (_contents == null)
-		// Range exception?
-		return 0;
-	else
-		// Should check for range exception?
-		return atoi(_contents->data);
+	int v;
+	// Should check for range exception?
+	number::parse(c_str(), size(), &v);
+	return v;
 }
 
 double string::toDouble() const {
-	if (_contents == null)
-		// Range exception?
-		return 0;
-	else
-		// Should check for range exceptions?
-		return xml::sax_to_double(_contents->data, _contents->length);
+	double x;
+	// Should check for range exceptions?
+	number::parse(c_str(), size(), &x);
+	return x;
 }
 
 bool string::toBool() const {
-	if (_contents) {
-		switch (_contents->length) {
-		case	4:
-			if (memcmp(_contents->data, "true", 4) == 0)
-				return true;
-			break;
-		case	5:
-			if (memcmp(_contents->data, "false", 5) == 0)
-				return false;
-			break;
-		}
+	switch (size()) {
+	case	4:
+		if (memcmp(c_str(), "true", 4) == 0)
+			return true;
+		break;
+	case	5:
+		if (memcmp(c_str(), "false", 5) == 0)
+			return false;
+		break;
 	}
 	// Range exception?
 	return false;
@@ -374,29 +656,1356 @@ int compare(const string& ref, const char* text, int length) {
 		return 0;
 }
 
-int string::hashValue() const {
-	if (_contents == null)
+static const unsigned __int64 HASH_PRIME_1 = 0x9E3779B185EBCA87ull;
+static const unsigned __int64 HASH_PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+static const unsigned __int64 HASH_PRIME_3 = 0x165667B19E3779F9ull;
+
+static inline unsigned __int64 read64(const unsigned char* p) {
+	unsigned __int64 v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+static inline unsigned __int64 read32(const unsigned char* p) {
+	unsigned v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+static inline unsigned __int64 hashRound(unsigned __int64 acc, unsigned __int64 lane) {
+	acc ^= lane * HASH_PRIME_2;
+	acc = (acc << 31) | (acc >> 33);
+	return acc * HASH_PRIME_1;
+}
+/*
+ *	lowerLane
+ *
+ *	Maps the ASCII upper case letters among the 8 bytes of 'lane' to
+ *	lower case.  Per byte, with the top bit masked off, adding 0x3f
+ *	carries into bit 7 from 'A' up and adding 0x25 carries from 'Z'+1
+ *	up, so the two sums differ in bit 7 exactly for 'A' to 'Z'.
+ */
+static inline unsigned __int64 lowerLane(unsigned __int64 lane) {
+	unsigned __int64 low = lane & 0x7f7f7f7f7f7f7f7full;
+	unsigned __int64 letters = ((low + 0x3f3f3f3f3f3f3f3full) ^ (low + 0x2525252525252525ull)) &
+							   ~lane & 0x8080808080808080ull;
+	return lane | (letters >> 2);
+}
+
+struct ExactLanes {
+	static unsigned __int64 lane(unsigned __int64 v) {
+		return v;
+	}
+};
+
+struct LowerCaseLanes {
+	static unsigned __int64 lane(unsigned __int64 v) {
+		return lowerLane(v);
+	}
+};
+/*
+ *	hashBytes
+ *
+ *	In the style of xxh3: the body is consumed 16 bytes per step in
+ *	two independent lanes, a tail of up to 15 bytes is folded into at
+ *	most two more 8 byte words, and the result is passed through the
+ *	MurmurHash3 finalizer so every input bit reaches every output bit.
+ *	Every word read goes through Lanes::lane first, which lets the
+ *	case-insensitive hash fold case on the fly.
+ */
+template<class Lanes>
+static int hashBytes(const char* data, int length) {
+	const unsigned char* p = (const unsigned char*)data;
+	int n = length;
+	unsigned __int64 h = HASH_PRIME_3 + length * HASH_PRIME_1;
+	if (n >= 16) {
+		unsigned __int64 h2 = HASH_PRIME_3 ^ HASH_PRIME_2;
+		do {
+			h = hashRound(h, Lanes::lane(read64(p)));
+			h2 = hashRound(h2, Lanes::lane(read64(p + 8)));
+			p += 16;
+			n -= 16;
+		} while (n >= 16);
+		h = hashRound(h, h2);
+	}
+	if (n >= 8) {
+		h = hashRound(h, Lanes::lane(read64(p)));
+		p += 8;
+		n -= 8;
+	}
+	if (n >= 4)
+		h = hashRound(h, Lanes::lane(read32(p) | (read32(p + n - 4) << 32)));
+	else if (n > 0)
+		h = hashRound(h, Lanes::lane(p[0] | (p[n >> 1] << 8) | (p[n - 1] << 16)));
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return (int)h;
+}
+
+int string::hashValue(const char* data, int length) {
+	return hashBytes<ExactLanes>(data, length);
+}
+
+int string::hashValueIgnoreCase(const char* data, int length) {
+	return hashBytes<LowerCaseLanes>(data, length);
+}
+
+int string::rfind(const string& key, int offset) const {
+	if (offset == npos || offset > size())
+		offset = size();
+	int keyLength = key.size();
+	if (keyLength == 0)
+		return offset;
+	const char* text = c_str();
+	const char* k = key.c_str();
+	int i = size() - keyLength;
+	if (i > offset - 1)
+		i = offset - 1;
+	for (; i >= 0; i--) {
+		if (text[i] == k[0] && memcmp(text + i + 1, k + 1, keyLength - 1) == 0)
+			return i;
+	}
+	return npos;
+}
+
+int string::findFirstOf(const char* text, int length, const char* set, int setLength) {
+	int i = 0;
+#ifdef STRING_SSE2
+	if (setLength <= 16) {
+		__m128i members[16];
+		for (int j = 0; j < setLength; j++)
+			members[j] = _mm_set1_epi8(set[j]);
+		for (; i + 16 <= length; i += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i*)(text + i));
+			__m128i found = _mm_setzero_si128();
+			for (int j = 0; j < setLength; j++)
+				found = _mm_or_si128(found, _mm_cmpeq_epi8(x, members[j]));
+			unsigned mask = _mm_movemask_epi8(found);
+			if (mask)
+				return i + firstSetBit(mask);
+		}
+	}
+#endif
+	unsigned char member[256];
+	memset(member, 0, sizeof member);
+	for (int j = 0; j < setLength; j++)
+		member[(unsigned char)set[j]] = 1;
+	for (; i < length; i++)
+		if (member[(unsigned char)text[i]])
+			return i;
+	return npos;
+}
+
+int string::count(const string& key) const {
+	if (key.size() == 0)
+		return 0;
+	int n = 0;
+	for (int i = find(key); i != npos; i = find(key, i + key.size()))
+		n++;
+	return n;
+}
+
+static const int TWO_WAY_THRESHOLD = 32;		// keys at least this long use twoWaySearch
+
+static int twoWaySearch(const unsigned char* text, int length, const unsigned char* key, int keyLength);
+
+int string::search(const char* text, int length, const char* key, int keyLength) {
+	if (keyLength == 0)
+		return 0;
+	if (keyLength > length)
+		return npos;
+	if (keyLength == 1) {
+		const char* cp = (const char*)memchr(text, key[0], length);
+		if (cp)
+			return (int)(cp - text);
+		else
+			return npos;
+	}
+	if (keyLength >= TWO_WAY_THRESHOLD)
+		return twoWaySearch((const unsigned char*)text, length, (const unsigned char*)key, keyLength);
+	int last = keyLength - 1;
+	int end = length - last;		// candidate starting offsets are [0, end)
+	int i = 0;
+#ifdef STRING_SSE2
+	__m128i first = _mm_set1_epi8(key[0]);
+	__m128i final = _mm_set1_epi8(key[last]);
+	for (; i + 16 <= end; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(text + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(text + i + last));
+		unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+														_mm_cmpeq_epi8(b, final)));
+		while (mask) {
+			int j = i + firstSetBit(mask);
+			if (memcmp(text + j + 1, key + 1, last - 1) == 0)
+				return j;
+			mask &= mask - 1;
+		}
+	}
+#endif
+	for (; i < end; i++) {
+		if (text[i] == key[0] && text[i + last] == key[last] &&
+			memcmp(text + i + 1, key + 1, last - 1) == 0)
+			return i;
+	}
+	return npos;
+}
+/*
+ *	twoWaySearch
+ *
+ *	Crochemore and Perrin's two-way string matching.  The key is split
+ *	at its critical factorization (found from the two maximal suffixes
+ *	under opposite orderings); the right half is matched left to right,
+ *	then the left half right to left, and the period of the key bounds
+ *	how far a partial match lets the search skip.  A table of the last
+ *	position of each byte in the key adds Boyer-Moore style skips on
+ *	the byte under the end of the window.
+ */
+static int twoWaySearch(const unsigned char* text, int length, const unsigned char* key, int keyLength) {
+	size_t l = keyLength;
+	size_t shift[256];
+	memset(shift, 0, sizeof shift);
+	for (size_t i = 0; i < l; i++)
+		shift[key[i]] = i + 1;
+
+	// Maximal suffix under the byte ordering
+	size_t ip = (size_t)-1;
+	size_t jp = 0;
+	size_t k = 1;
+	size_t p = 1;
+	while (jp + k < l) {
+		if (key[ip + k] == key[jp + k]) {
+			if (k == p) {
+				jp += p;
+				k = 1;
+			} else
+				k++;
+		} else if (key[ip + k] > key[jp + k]) {
+			jp += k;
+			k = 1;
+			p = jp - ip;
+		} else {
+			ip = jp++;
+			k = p = 1;
+		}
+	}
+	size_t ms = ip;
+	size_t p0 = p;
+
+	// ... and under the reverse ordering
+	ip = (size_t)-1;
+	jp = 0;
+	k = p = 1;
+	while (jp + k < l) {
+		if (key[ip + k] == key[jp + k]) {
+			if (k == p) {
+				jp += p;
+				k = 1;
+			} else
+				k++;
+		} else if (key[ip + k] < key[jp + k]) {
+			jp += k;
+			k = 1;
+			p = jp - ip;
+		} else {
+			ip = jp++;
+			k = p = 1;
+		}
+	}
+	if (ip + 1 > ms + 1)
+		ms = ip;
+	else
+		p = p0;
+
+	size_t mem0;
+	if (memcmp(key, key + p, ms + 1)) {
+		// Not periodic: any mismatch allows a shift past the longer half
+		mem0 = 0;
+		p = (ms > l - ms - 1 ? ms : l - ms - 1) + 1;
+	} else
+		mem0 = l - p;
+	size_t mem = 0;
+
+	const unsigned char* h = text;
+	const unsigned char* z = text + length;
+	for (;;) {
+		if ((size_t)(z - h) < l)
+			return string::npos;
+		k = l - shift[h[l - 1]];
+		if (k) {
+			if (k < mem)
+				k = mem;
+			h += k;
+			mem = 0;
+			continue;
+		}
+		for (k = (ms + 1 > mem ? ms + 1 : mem); k < l && key[k] == h[k]; k++)
+			;
+		if (k < l) {
+			h += k - ms;
+			mem = 0;
+			continue;
+		}
+		for (k = ms + 1; k > mem && key[k - 1] == h[k - 1]; k--)
+			;
+		if (k <= mem)
+			return (int)(h - text);
+		h += p;
+		mem = mem0;
+	}
+}
+
+namespace number {
+
+static const double POWERS_OF_TEN[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int MAX_EXACT_POWER = 22;					// every power of ten up to here is an exact double
+static const double MAX_EXACT_INTEGER = 9007199254740992.0;	// 2^53
+static const int MAX_MANTISSA_DIGITS = 19;				// always fit in an unsigned __int64
+
+static inline bool isSpace(char c) {
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+/*
+ *	writeDigits
+ *
+ *	Writes the decimal digits of 'v' at 'output', with no null.
+ *
+ *	RETURNS:
+ *		The number of digits written.
+ */
+static int writeDigits(char* output, unsigned __int64 v) {
+	char digits[20];
+	int n = 0;
+	do {
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v);
+	for (int i = 0; i < n; i++)
+		output[i] = digits[n - 1 - i];
+	return n;
+}
+
+int format(char* buffer, int v) {
+	return format(buffer, (__int64)v);
+}
+
+int format(char* buffer, unsigned v) {
+	return format(buffer, (unsigned __int64)v);
+}
+
+int format(char* buffer, __int64 v) {
+	if (v < 0) {
+		buffer[0] = '-';
+		int n = 1 + writeDigits(buffer + 1, 0 - (unsigned __int64)v);
+		buffer[n] = 0;
+		return n;
+	} else
+		return format(buffer, (unsigned __int64)v);
+}
+
+int format(char* buffer, unsigned __int64 v) {
+	int n = writeDigits(buffer, v);
+	buffer[n] = 0;
+	return n;
+}
+/*
+ *	BigInteger
+ *
+ *	A fixed size unsigned integer for the exact conversions below.  It
+ *	lives on the stack, so even the slow paths allocate nothing.  The
+ *	largest value they build is about 10^1124 * 2^53, from parsing
+ *	MAX_PARSED_DIGITS digits of a number near the smallest subnormal.
+ */
+class BigInteger {
+public:
+	BigInteger(unsigned __int64 v = 0) {
+		_used = 0;
+		while (v) {
+			_words[_used++] = (unsigned)v;
+			v >>= 32;
+		}
+	}
+
+	BigInteger(const BigInteger& b) {
+		_used = b._used;
+		memcpy(_words, b._words, _used * sizeof (unsigned));
+	}
+
+	bool isZero() const {
+		return _used == 0;
+	}
+
+	int bitLength() const {
+		if (_used == 0)
+			return 0;
+		int bits = (_used - 1) * 32;
+		for (unsigned w = _words[_used - 1]; w; w >>= 1)
+			bits++;
+		return bits;
+	}
+
+	void multiply(unsigned m) {
+		unsigned __int64 carry = 0;
+		for (int i = 0; i < _used; i++) {
+			carry += (unsigned __int64)_words[i] * m;
+			_words[i] = (unsigned)carry;
+			carry >>= 32;
+		}
+		if (carry)
+			_words[_used++] = (unsigned)carry;
+	}
+
+	void multiplyAdd(unsigned m, unsigned a) {
+		unsigned __int64 carry = a;
+		for (int i = 0; i < _used; i++) {
+			carry += (unsigned __int64)_words[i] * m;
+			_words[i] = (unsigned)carry;
+			carry >>= 32;
+		}
+		if (carry)
+			_words[_used++] = (unsigned)carry;
+	}
+
+	void multiplyByPowerOfTen(int n) {
+		for (; n >= 9; n -= 9)
+			multiply(1000000000);
+		unsigned m = 1;
+		for (; n > 0; n--)
+			m *= 10;
+		if (m > 1)
+			multiply(m);
+	}
+
+	void shiftLeft(int bits) {
+		if (_used == 0 || bits == 0)
+			return;
+		int words = bits / 32;
+		bits %= 32;
+		if (bits) {
+			_words[_used] = 0;
+			for (int i = _used; i > 0; i--)
+				_words[i] = (_words[i] << bits) | (_words[i - 1] >> (32 - bits));
+			_words[0] <<= bits;
+			if (_words[_used])
+				_used++;
+		}
+		if (words) {
+			for (int i = _used - 1; i >= 0; i--)
+				_words[i + words] = _words[i];
+			for (int i = 0; i < words; i++)
+				_words[i] = 0;
+			_used += words;
+		}
+	}
+
+	void shiftRight(int bits) {
+		int words = bits / 32;
+		bits %= 32;
+		if (words >= _used) {
+			_used = 0;
+			return;
+		}
+		_used -= words;
+		for (int i = 0; i < _used; i++)
+			_words[i] = _words[i + words];
+		if (bits) {
+			for (int i = 0; i < _used - 1; i++)
+				_words[i] = (_words[i] >> bits) | (_words[i + 1] << (32 - bits));
+			_words[_used - 1] >>= bits;
+		}
+		trim();
+	}
+
+	void add(const BigInteger& b) {
+		unsigned __int64 carry = 0;
+		int n = _used > b._used ? _used : b._used;
+		for (int i = 0; i < n; i++) {
+			carry += (unsigned __int64)(i < _used ? _words[i] : 0) + (i < b._used ? b._words[i] : 0);
+			_words[i] = (unsigned)carry;
+			carry >>= 32;
+		}
+		_used = n;
+		if (carry)
+			_words[_used++] = (unsigned)carry;
+	}
+	/*
+	 *	subtract
+	 *
+	 *	'b' must be no greater than this.
+	 */
+	void subtract(const BigInteger& b) {
+		__int64 borrow = 0;
+		for (int i = 0; i < _used; i++) {
+			borrow += (__int64)_words[i] - (i < b._used ? b._words[i] : 0);
+			_words[i] = (unsigned)borrow;
+			borrow >>= 32;
+		}
+		trim();
+	}
+
+	static int compare(const BigInteger& a, const BigInteger& b) {
+		if (a._used != b._used)
+			return a._used < b._used ? -1 : 1;
+		for (int i = a._used - 1; i >= 0; i--) {
+			if (a._words[i] != b._words[i])
+				return a._words[i] < b._words[i] ? -1 : 1;
+		}
+		return 0;
+	}
+	/*
+	 *	compareSum
+	 *
+	 *	Compares a + b with c.
+	 */
+	static int compareSum(const BigInteger& a, const BigInteger& b, const BigInteger& c) {
+		BigInteger sum(a);
+		sum.add(b);
+		return compare(sum, c);
+	}
+
+private:
+	static const int WORDS = 136;
+
+	void trim() {
+		while (_used > 0 && _words[_used - 1] == 0)
+			_used--;
+	}
+
+	unsigned	_words[WORDS];
+	int			_used;
+};
+
+static const int MAX_PARSED_DIGITS = 800;			// digits past these only break ties
+static const int DOUBLE_MIN_EXPONENT = -1074;		// of the unit in the last place of a subnormal
+static const int DOUBLE_MAX_EXPONENT = 971;			// of the unit in the last place of the largest double
+static const unsigned __int64 HIDDEN_BIT = 1ULL << 52;
+
+static int bitLength(unsigned __int64 v) {
+	int n = 0;
+	for (; v; v >>= 1)
+		n++;
+	return n;
+}
+/*
+ *	shortestDecimal
+ *
+ *	Finds the shortest decimal m * 10^e that reads back as the finite,
+ *	positive 'x', choosing the closest to 'x' if there is more than one.
+ *	This is the slow path, for the few doubles grisu3 (below) cannot
+ *	decide.  It is the free-format algorithm of Steele & White as refined
+ *	by Burger & Dybvig, carried out in exact integer arithmetic: r / s is
+ *	the value still to be written, and m+ / s and m- / s are the
+ *	distances to the midpoints between 'x' and its neighbours.  Any
+ *	decimal strictly between those midpoints (or on one of them, when
+ *	x's significand is even) reads back as x.
+ */
+static void shortestDecimal(double x, unsigned __int64* m, int* e) {
+	unsigned __int64 bits;
+	memcpy(&bits, &x, sizeof bits);
+	int biasedExponent = (int)(bits >> 52) & 0x7ff;
+	unsigned __int64 f = bits & (HIDDEN_BIT - 1);
+	int exponent;
+	if (biasedExponent == 0)
+		exponent = DOUBLE_MIN_EXPONENT;
+	else {
+		f |= HIDDEN_BIT;
+		exponent = biasedExponent - 1075;
+	}
+	bool even = (f & 1) == 0;
+		// The gap below the lowest significand of a binade is half the
+		// gap above it.
+	bool unequalGaps = f == HIDDEN_BIT && biasedExponent > 1;
+
+	BigInteger r(f);
+	BigInteger s(1);
+	BigInteger mPlus(1);
+	BigInteger mMinus(1);
+	if (exponent >= 0) {
+		r.shiftLeft(exponent + 1);
+		s.shiftLeft(1);
+		mPlus.shiftLeft(exponent);
+		mMinus.shiftLeft(exponent);
+	} else {
+		r.shiftLeft(1);
+		s.shiftLeft(1 - exponent);
+	}
+	if (unequalGaps) {
+		r.shiftLeft(1);
+		s.shiftLeft(1);
+		mPlus.shiftLeft(1);
+	}
+		// Scale by 10^-k so that (r + m+) / s is just below 1.  The
+		// estimate of k is never too large, and at most two too small.
+
+	int k = (int)ceil((bitLength(f) + exponent - 1) * 0.30102999566398114 - 1e-10);
+	if (k >= 0)
+		s.multiplyByPowerOfTen(k);
+	else {
+		r.multiplyByPowerOfTen(-k);
+		mPlus.multiplyByPowerOfTen(-k);
+		mMinus.multiplyByPowerOfTen(-k);
+	}
+	for (;;) {
+		int c = BigInteger::compareSum(r, mPlus, s);
+		if (c < 0 || (c == 0 && !even))
+			break;
+		s.multiply(10);
+		k++;
+	}
+	unsigned __int64 digits = 0;
+	int n = 0;
+	for (;;) {
+		r.multiply(10);
+		mPlus.multiply(10);
+		mMinus.multiply(10);
+		int digit = 0;
+		while (BigInteger::compare(r, s) >= 0) {
+			r.subtract(s);
+			digit++;
+		}
+		int low = BigInteger::compare(r, mMinus);
+		int high = BigInteger::compareSum(r, mPlus, s);
+		bool roundDown = low < 0 || (low == 0 && even);
+		bool roundUp = high > 0 || (high == 0 && even);
+		if (roundDown && roundUp) {
+			BigInteger twice(r);
+			twice.shiftLeft(1);
+			if (BigInteger::compare(twice, s) >= 0)
+				digit++;
+		} else if (roundUp)
+			digit++;
+		digits = digits * 10 + digit;
+		n++;
+		if (roundDown || roundUp)
+			break;
+	}
+	*m = digits;
+	*e = k - n;
+}
+/*
+ *	DiyFp
+ *
+ *	A floating point value with a 64 bit significand and no sign: f * 2^e.
+ *	Products are rounded to 64 bits, so they carry at most half a unit of
+ *	error in f.
+ */
+struct DiyFp {
+	unsigned __int64	f;
+	int					e;
+
+	DiyFp() {
+		f = 0;
+		e = 0;
+	}
+
+	DiyFp(unsigned __int64 f, int e) {
+		this->f = f;
+		this->e = e;
+	}
+
+	DiyFp times(const DiyFp& b) const {
+		const unsigned __int64 M32 = 0xffffffffu;
+		unsigned __int64 ah = f >> 32;
+		unsigned __int64 al = f & M32;
+		unsigned __int64 bh = b.f >> 32;
+		unsigned __int64 bl = b.f & M32;
+		unsigned __int64 hh = ah * bh;
+		unsigned __int64 lh = al * bh;
+		unsigned __int64 hl = ah * bl;
+		unsigned __int64 ll = al * bl;
+		unsigned __int64 middle = (ll >> 32) + (hl & M32) + (lh & M32) + (1U << 31);
+		return DiyFp(hh + (hl >> 32) + (lh >> 32) + (middle >> 32), e + b.e + 64);
+	}
+
+	DiyFp normalized() const {
+		DiyFp n(f, e);
+		while ((n.f & (1ULL << 63)) == 0) {
+			n.f <<= 1;
+			n.e--;
+		}
+		return n;
+	}
+};
+
+struct CachedPower {
+	unsigned __int64	f;
+	short				e;
+	short				decimalExponent;
+};
+/*
+ *	CACHED_POWERS
+ *
+ *	10^k for every eighth k from -348 to 340, each rounded to a 64 bit
+ *	significand.
+ */
+static const CachedPower CACHED_POWERS[] = {
+	{ 0xfa8fd5a0081c0288ULL, -1220, -348 },
+	{ 0xbaaee17fa23ebf76ULL, -1193, -340 },
+	{ 0x8b16fb203055ac76ULL, -1166, -332 },
+	{ 0xcf42894a5dce35eaULL, -1140, -324 },
+	{ 0x9a6bb0aa55653b2dULL, -1113, -316 },
+	{ 0xe61acf033d1a45dfULL, -1087, -308 },
+	{ 0xab70fe17c79ac6caULL, -1060, -300 },
+	{ 0xff77b1fcbebcdc4fULL, -1034, -292 },
+	{ 0xbe5691ef416bd60cULL, -1007, -284 },
+	{ 0x8dd01fad907ffc3cULL, -980, -276 },
+	{ 0xd3515c2831559a83ULL, -954, -268 },
+	{ 0x9d71ac8fada6c9b5ULL, -927, -260 },
+	{ 0xea9c227723ee8bcbULL, -901, -252 },
+	{ 0xaecc49914078536dULL, -874, -244 },
+	{ 0x823c12795db6ce57ULL, -847, -236 },
+	{ 0xc21094364dfb5637ULL, -821, -228 },
+	{ 0x9096ea6f3848984fULL, -794, -220 },
+	{ 0xd77485cb25823ac7ULL, -768, -212 },
+	{ 0xa086cfcd97bf97f4ULL, -741, -204 },
+	{ 0xef340a98172aace5ULL, -715, -196 },
+	{ 0xb23867fb2a35b28eULL, -688, -188 },
+	{ 0x84c8d4dfd2c63f3bULL, -661, -180 },
+	{ 0xc5dd44271ad3cdbaULL, -635, -172 },
+	{ 0x936b9fcebb25c996ULL, -608, -164 },
+	{ 0xdbac6c247d62a584ULL, -582, -156 },
+	{ 0xa3ab66580d5fdaf6ULL, -555, -148 },
+	{ 0xf3e2f893dec3f126ULL, -529, -140 },
+	{ 0xb5b5ada8aaff80b8ULL, -502, -132 },
+	{ 0x87625f056c7c4a8bULL, -475, -124 },
+	{ 0xc9bcff6034c13053ULL, -449, -116 },
+	{ 0x964e858c91ba2655ULL, -422, -108 },
+	{ 0xdff9772470297ebdULL, -396, -100 },
+	{ 0xa6dfbd9fb8e5b88fULL, -369, -92 },
+	{ 0xf8a95fcf88747d94ULL, -343, -84 },
+	{ 0xb94470938fa89bcfULL, -316, -76 },
+	{ 0x8a08f0f8bf0f156bULL, -289, -68 },
+	{ 0xcdb02555653131b6ULL, -263, -60 },
+	{ 0x993fe2c6d07b7facULL, -236, -52 },
+	{ 0xe45c10c42a2b3b06ULL, -210, -44 },
+	{ 0xaa242499697392d3ULL, -183, -36 },
+	{ 0xfd87b5f28300ca0eULL, -157, -28 },
+	{ 0xbce5086492111aebULL, -130, -20 },
+	{ 0x8cbccc096f5088ccULL, -103, -12 },
+	{ 0xd1b71758e219652cULL, -77, -4 },
+	{ 0x9c40000000000000ULL, -50, 4 },
+	{ 0xe8d4a51000000000ULL, -24, 12 },
+	{ 0xad78ebc5ac620000ULL, 3, 20 },
+	{ 0x813f3978f8940984ULL, 30, 28 },
+	{ 0xc097ce7bc90715b3ULL, 56, 36 },
+	{ 0x8f7e32ce7bea5c70ULL, 83, 44 },
+	{ 0xd5d238a4abe98068ULL, 109, 52 },
+	{ 0x9f4f2726179a2245ULL, 136, 60 },
+	{ 0xed63a231d4c4fb27ULL, 162, 68 },
+	{ 0xb0de65388cc8ada8ULL, 189, 76 },
+	{ 0x83c7088e1aab65dbULL, 216, 84 },
+	{ 0xc45d1df942711d9aULL, 242, 92 },
+	{ 0x924d692ca61be758ULL, 269, 100 },
+	{ 0xda01ee641a708deaULL, 295, 108 },
+	{ 0xa26da3999aef774aULL, 322, 116 },
+	{ 0xf209787bb47d6b85ULL, 348, 124 },
+	{ 0xb454e4a179dd1877ULL, 375, 132 },
+	{ 0x865b86925b9bc5c2ULL, 402, 140 },
+	{ 0xc83553c5c8965d3dULL, 428, 148 },
+	{ 0x952ab45cfa97a0b3ULL, 455, 156 },
+	{ 0xde469fbd99a05fe3ULL, 481, 164 },
+	{ 0xa59bc234db398c25ULL, 508, 172 },
+	{ 0xf6c69a72a3989f5cULL, 534, 180 },
+	{ 0xb7dcbf5354e9beceULL, 561, 188 },
+	{ 0x88fcf317f22241e2ULL, 588, 196 },
+	{ 0xcc20ce9bd35c78a5ULL, 614, 204 },
+	{ 0x98165af37b2153dfULL, 641, 212 },
+	{ 0xe2a0b5dc971f303aULL, 667, 220 },
+	{ 0xa8d9d1535ce3b396ULL, 694, 228 },
+	{ 0xfb9b7cd9a4a7443cULL, 720, 236 },
+	{ 0xbb764c4ca7a44410ULL, 747, 244 },
+	{ 0x8bab8eefb6409c1aULL, 774, 252 },
+	{ 0xd01fef10a657842cULL, 800, 260 },
+	{ 0x9b10a4e5e9913129ULL, 827, 268 },
+	{ 0xe7109bfba19c0c9dULL, 853, 276 },
+	{ 0xac2820d9623bf429ULL, 880, 284 },
+	{ 0x80444b5e7aa7cf85ULL, 907, 292 },
+	{ 0xbf21e44003acdd2dULL, 933, 300 },
+	{ 0x8e679c2f5e44ff8fULL, 960, 308 },
+	{ 0xd433179d9c8cb841ULL, 986, 316 },
+	{ 0x9e19db92b4e31ba9ULL, 1013, 324 },
+	{ 0xeb96bf6ebadf77d9ULL, 1039, 332 },
+	{ 0xaf87023b9bf0ee6bULL, 1066, 340 },
+};
+static const int CACHED_POWERS_OFFSET = 348;			// -decimalExponent of the first entry
+static const int CACHED_POWERS_STEP = 8;
+/*
+ *	ADJUSTMENT_POWERS
+ *
+ *	10^1 through 10^7, exactly, for the gaps between cached powers.
+ */
+static const CachedPower ADJUSTMENT_POWERS[] = {
+	{ 0xa000000000000000ULL, -60, 1 },
+	{ 0xc800000000000000ULL, -57, 2 },
+	{ 0xfa00000000000000ULL, -54, 3 },
+	{ 0x9c40000000000000ULL, -50, 4 },
+	{ 0xc350000000000000ULL, -47, 5 },
+	{ 0xf424000000000000ULL, -44, 6 },
+	{ 0x9896800000000000ULL, -40, 7 }
+};
+/*
+ *	roundWeed
+ *
+ *	Grisu3's last step.  The digits generated so far, followed by 'rest'
+ *	(in units of 'tenKappa' per last digit), lie inside the unsafe
+ *	interval; this moves the last digit down towards 'x' while that
+ *	stays inside, then checks that the result is certainly the closest
+ *	shortest decimal despite the 'unit' of error in every input.
+ *
+ *	RETURNS:
+ *		false - if the error is too large to tell.
+ */
+static bool roundWeed(unsigned __int64* digits, unsigned __int64 distanceTooHighW,
+					  unsigned __int64 unsafeInterval, unsigned __int64 rest,
+					  unsigned __int64 tenKappa, unsigned __int64 unit) {
+	unsigned __int64 smallDistance = distanceTooHighW - unit;
+	unsigned __int64 bigDistance = distanceTooHighW + unit;
+	while (rest < smallDistance &&
+		   unsafeInterval - rest >= tenKappa &&
+		   (rest + tenKappa < smallDistance ||
+			smallDistance - rest >= rest + tenKappa - smallDistance)) {
+		(*digits)--;
+		rest += tenKappa;
+	}
+	if (rest < bigDistance &&
+		unsafeInterval - rest >= tenKappa &&
+		(rest + tenKappa < bigDistance ||
+		 bigDistance - rest > rest + tenKappa - bigDistance))
+		return false;
+	return 2 * unit <= rest && rest <= unsafeInterval - 4 * unit;
+}
+/*
+ *	grisu3
+ *
+ *	Finds the shortest, closest decimal m * 10^e that reads back as the
+ *	finite, positive 'x', using Florian Loitsch's Grisu3: 'x' and the
+ *	midpoints to its neighbours are scaled by a cached power of ten into
+ *	64 bit fixed point and digits are generated from the upper midpoint
+ *	until they fall between the two.  All of the arithmetic is done in
+ *	64 bits, which is enough to be sure of the answer for all but about
+ *	one double in two hundred.
+ *
+ *	RETURNS:
+ *		false - if the answer could not be proven, and *m and *e are
+ *		not set.
+ */
+static bool grisu3(double x, unsigned __int64* m, int* e) {
+	unsigned __int64 bits;
+	memcpy(&bits, &x, sizeof bits);
+	int biasedExponent = (int)(bits >> 52) & 0x7ff;
+	DiyFp v(bits & (HIDDEN_BIT - 1), DOUBLE_MIN_EXPONENT);
+	if (biasedExponent != 0) {
+		v.f |= HIDDEN_BIT;
+		v.e = biasedExponent - 1075;
+	}
+	DiyFp w = v.normalized();
+	DiyFp plus = DiyFp((v.f << 1) + 1, v.e - 1).normalized();
+	DiyFp minus;
+	if (v.f == HIDDEN_BIT && biasedExponent > 1)
+		minus = DiyFp((v.f << 2) - 1, v.e - 2);
+	else
+		minus = DiyFp((v.f << 1) - 1, v.e - 1);
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+		// Pick the cached power that brings the binary exponent of the
+		// scaled values into [-60, -32]: the integer part then fits in
+		// 32 bits and the fraction has room for a decimal digit.
+
+	int minExponent = -60 - (w.e + 64);
+	int k = (int)ceil((minExponent + 63) * 0.30102999566398114);
+	const CachedPower& power = CACHED_POWERS[(CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_STEP + 1];
+	DiyFp tenMk(power.f, power.e);
+	DiyFp scaledW = w.times(tenMk);
+	DiyFp tooLow = minus.times(tenMk);
+	DiyFp tooHigh = plus.times(tenMk);
+	tooLow.f--;
+	tooHigh.f++;
+
+	unsigned __int64 unit = 1;
+	unsigned __int64 unsafeInterval = tooHigh.f - tooLow.f;
+	int shift = -scaledW.e;
+	unsigned __int64 one = 1ULL << shift;
+	unsigned integrals = (unsigned)(tooHigh.f >> shift);
+	unsigned __int64 fractionals = tooHigh.f & (one - 1);
+	unsigned divisor = 1;
+	int kappa = 0;
+	if (integrals) {
+		kappa = 1;
+		while (divisor <= integrals / 10) {
+			divisor *= 10;
+			kappa++;
+		}
+	}
+	unsigned __int64 digits = 0;
+	while (kappa > 0) {
+		digits = digits * 10 + integrals / divisor;
+		integrals %= divisor;
+		kappa--;
+		unsigned __int64 rest = ((unsigned __int64)integrals << shift) + fractionals;
+		if (rest < unsafeInterval) {
+			if (!roundWeed(&digits, tooHigh.f - scaledW.f, unsafeInterval, rest,
+						   (unsigned __int64)divisor << shift, unit))
+				return false;
+			*m = digits;
+			*e = kappa - power.decimalExponent;
+			return true;
+		}
+		divisor /= 10;
+	}
+	for (;;) {
+		fractionals *= 10;
+		unit *= 10;
+		unsafeInterval *= 10;
+		digits = digits * 10 + (fractionals >> shift);
+		fractionals &= one - 1;
+		kappa--;
+		if (fractionals < unsafeInterval) {
+			if (!roundWeed(&digits, (tooHigh.f - scaledW.f) * unit, unsafeInterval,
+						   fractionals, one, unit))
+				return false;
+			*m = digits;
+			*e = kappa - power.decimalExponent;
+			return true;
+		}
+	}
+}
+
+int format(char* buffer, double x) {
+	char* output = buffer;
+	unsigned __int64 bits;
+	memcpy(&bits, &x, sizeof bits);
+	if (x != x) {
+		memcpy(output, "nan", 4);
+		return 3;
+	}
+	if (bits >> 63) {
+		*output++ = '-';
+		x = -x;
+	}
+	if (x == 0) {
+		memcpy(output, "0", 2);
+		return (int)(output - buffer) + 1;
+	}
+	if (x > 1.7976931348623157e308) {
+		memcpy(output, "inf", 4);
+		return (int)(output - buffer) + 3;
+	}
+	unsigned __int64 m;
+	int e;
+	if (!grisu3(x, &m, &e))
+		shortestDecimal(x, &m, &e);
+	while (m % 10 == 0) {
+		m /= 10;
+		e++;
+	}
+	char digits[20];
+	int n = writeDigits(digits, m);
+	int scientific = n - 1 + e;
+	if (scientific < -4 || scientific >= 17) {
+		*output++ = digits[0];
+		if (n > 1) {
+			*output++ = '.';
+			memcpy(output, digits + 1, n - 1);
+			output += n - 1;
+		}
+		*output++ = 'e';
+		if (scientific < 0) {
+			*output++ = '-';
+			scientific = -scientific;
+		} else
+			*output++ = '+';
+		if (scientific < 10)
+			*output++ = '0';
+		output += writeDigits(output, scientific);
+	} else if (e >= 0) {
+		memcpy(output, digits, n);
+		output += n;
+		for (int i = 0; i < e; i++)
+			*output++ = '0';
+	} else if (n + e > 0) {
+		memcpy(output, digits, n + e);
+		output += n + e;
+		*output++ = '.';
+		memcpy(output, digits + n + e, -e);
+		output += -e;
+	} else {
+		*output++ = '0';
+		*output++ = '.';
+		for (int i = n + e; i < 0; i++)
+			*output++ = '0';
+		memcpy(output, digits, n);
+		output += n;
+	}
+	*output = 0;
+	return (int)(output - buffer);
+}
+
+int parse(const char* text, int length, int* value) {
+	int i = 0;
+	while (i < length && isSpace(text[i]))
+		i++;
+	bool negative = false;
+	if (i < length && (text[i] == '-' || text[i] == '+')) {
+		negative = text[i] == '-';
+		i++;
+	}
+	int start = i;
+	unsigned v = 0;
+	for (; i < length && isDigit(text[i]); i++)
+		v = v * 10 + (text[i] - '0');
+	if (negative)
+		*value = -(int)v;
+	else
+		*value = (int)v;
+	if (i == start)
 		return 0;
-	int v = _contents->length;
-	switch (v) {
-	case 0:
+	else
+		return i;
+}
+
+static double infinity() {
+	unsigned __int64 bits = 0x7ff0000000000000ULL;
+	double x;
+	memcpy(&x, &bits, sizeof x);
+	return x;
+}
+
+static double notANumber() {
+	unsigned __int64 bits = 0x7ff8000000000000ULL;
+	double x;
+	memcpy(&x, &bits, sizeof x);
+	return x;
+}
+/*
+ *	divide
+ *
+ *	Divides n by d * 2^shift, where the quotient is known to be below
+ *	2^54, by shifting and subtracting one quotient bit at a time.
+ *
+ *	RETURNS:
+ *		The quotient, rounded down.  *half is set to the comparison of
+ *		the remainder with half of the divisor.
+ */
+static unsigned __int64 divide(BigInteger n, BigInteger d, int shift, int* half) {
+	if (shift < 0)
+		n.shiftLeft(-shift);
+	else
+		d.shiftLeft(shift);
+	BigInteger t(d);
+	t.shiftLeft(54);
+	unsigned __int64 q = 0;
+	for (int bit = 53; bit >= 0; bit--) {
+		t.shiftRight(1);
+		if (BigInteger::compare(n, t) >= 0) {
+			n.subtract(t);
+			q |= 1ULL << bit;
+		}
+	}
+	n.shiftLeft(1);
+	*half = BigInteger::compare(n, d);
+	return q;
+}
+/*
+ *	toDouble
+ *
+ *	Converts f * 2^e, where f has at most 53 significant bits, to the
+ *	double of exactly that value, or to infinity or zero if it is out of
+ *	range.
+ */
+static double toDouble(unsigned __int64 f, int e) {
+	while (f >= 2 * HIDDEN_BIT) {
+		f >>= 1;
+		e++;
+	}
+	if (e > DOUBLE_MAX_EXPONENT)
+		return infinity();
+	if (e < DOUBLE_MIN_EXPONENT)
 		return 0;
+	while (e > DOUBLE_MIN_EXPONENT && (f & HIDDEN_BIT) == 0) {
+		f <<= 1;
+		e--;
+	}
+	unsigned __int64 biasedExponent;
+	if (e == DOUBLE_MIN_EXPONENT && (f & HIDDEN_BIT) == 0)
+		biasedExponent = 0;
+	else
+		biasedExponent = (unsigned __int64)(e + 1075);
+	unsigned __int64 bits = (f & (HIDDEN_BIT - 1)) | (biasedExponent << 52);
+	double x;
+	memcpy(&x, &bits, sizeof x);
+	return x;
+}
+/*
+ *	estimate
+ *
+ *	Computes m * 10^exponent in 64 bit fixed point, from the cached power
+ *	of ten, keeping track of the possible error in eighths of a unit.
+ *	'digits' is the number of decimal digits in m and 'inexact' says that
+ *	digits were dropped from the end of m.  If the error could not move
+ *	the result across a rounding boundary, *x is set to the correctly
+ *	rounded double.
+ *
+ *	RETURNS:
+ *		false - if the estimate is too close to a tie to decide.
+ */
+static bool estimate(unsigned __int64 m, int digits, int exponent, bool inexact, double* x) {
+	const int DENOMINATOR_LOG = 3;
+	const int DENOMINATOR = 1 << DENOMINATOR_LOG;
+	DiyFp input(m, 0);
+	unsigned __int64 error = inexact ? DENOMINATOR : 0;
+	DiyFp normal = input.normalized();
+	error <<= input.e - normal.e;
+	input = normal;
 
-	case 1:
-		return _contents->data[0];
+	int index = (exponent + CACHED_POWERS_OFFSET) / CACHED_POWERS_STEP;
+	const CachedPower& power = CACHED_POWERS[index];
+	if (power.decimalExponent != exponent) {
+		int adjustment = exponent - power.decimalExponent;
+		const CachedPower& adjustmentPower = ADJUSTMENT_POWERS[adjustment - 1];
+		input = input.times(DiyFp(adjustmentPower.f, adjustmentPower.e));
+			// The adjustment power is exact, and so is the product if it
+			// fits in 64 bits.
+		if (MAX_MANTISSA_DIGITS - digits < adjustment)
+			error += DENOMINATOR / 2;
+	}
+	input = input.times(DiyFp(power.f, power.e));
+		// The cached power is off by at most half a unit, the product
+		// adds another half, and rounding the error term adds at most one
+		// more eighth.
+	error += DENOMINATOR / 2 + (error == 0 ? 0 : 1) + DENOMINATOR / 2;
+	normal = input.normalized();
+	error <<= input.e - normal.e;
+	input = normal;
 
-	case 2:
-		return *(unsigned short*)_contents->data;
+	int orderOfMagnitude = 64 + input.e;
+	int significandSize;
+	if (orderOfMagnitude >= DOUBLE_MIN_EXPONENT + 53)
+		significandSize = 53;
+	else if (orderOfMagnitude <= DOUBLE_MIN_EXPONENT)
+		significandSize = 0;
+	else
+		significandSize = orderOfMagnitude - DOUBLE_MIN_EXPONENT;
+	int precisionBits = 64 - significandSize;
+	if (precisionBits + DENOMINATOR_LOG >= 64) {
+			// Only the smallest subnormals get here: make room for the
+			// error term by giving up some precision.
+		int shift = precisionBits + DENOMINATOR_LOG - 64 + 1;
+		input.f >>= shift;
+		input.e += shift;
+		error = (error >> shift) + 1 + DENOMINATOR;
+		precisionBits -= shift;
+	}
+	unsigned __int64 low = (input.f & ((1ULL << precisionBits) - 1)) * DENOMINATOR;
+	unsigned __int64 halfWay = (1ULL << (precisionBits - 1)) * DENOMINATOR;
+	if (halfWay - error < low && low < halfWay + error)
+		return false;
+	unsigned __int64 f = input.f >> precisionBits;
+	if (low >= halfWay + error)
+		f++;
+	*x = toDouble(f, input.e + precisionBits);
+	return true;
+}
+/*
+ *	parseExactly
+ *
+ *	Converts the decimal mantissa in the 'length' characters at 'text'
+ *	(digits with at most one '.'), times 10^exponent, to the nearest
+ *	double, ties to even, by dividing one big integer by another.  Only
+ *	the first MAX_PARSED_DIGITS significant digits take part; a non-zero
+ *	digit beyond those only tells that the value lies above them, which
+ *	is all that can matter when it is that close to a tie.
+ */
+static double parseExactly(const char* text, int length, int exponent) {
+	BigInteger numerator;
+	int kept = 0;
+	bool fraction = false;
+	bool truncated = false;
+	unsigned chunk = 0;
+	unsigned chunkScale = 1;
+	for (int i = 0; i < length; i++) {
+		char c = text[i];
+		if (c == '.') {
+			fraction = true;
+			continue;
+		}
+		if (kept < MAX_PARSED_DIGITS) {
+			if (kept > 0 || c != '0') {
+				chunk = chunk * 10 + (c - '0');
+				chunkScale *= 10;
+				kept++;
+				if (chunkScale == 1000000000) {
+					numerator.multiplyAdd(chunkScale, chunk);
+					chunk = 0;
+					chunkScale = 1;
+				}
+			}
+			if (fraction)
+				exponent--;
+		} else {
+			if (!fraction)
+				exponent++;
+			if (c != '0')
+				truncated = true;
+		}
+	}
+	if (chunkScale > 1)
+		numerator.multiplyAdd(chunkScale, chunk);
+	if (numerator.isZero())
+		return 0;
+		// The value is at least 10^(kept + exponent - 1) and less than
+		// 10^(kept + exponent).
 
-	case 3:
-		return *(unsigned short*)_contents->data + (_contents->data[2] << 2);
+	if (kept + exponent > 310)
+		return infinity();
+	if (kept + exponent < -324)
+		return 0;
+	BigInteger denominator(1);
+	if (exponent >= 0)
+		numerator.multiplyByPowerOfTen(exponent);
+	else
+		denominator.multiplyByPowerOfTen(-exponent);
+		// Choose 'shift' so the quotient has 53 significant bits, or fewer
+		// for a subnormal.
 
-	case 4:
-		return *(unsigned short*)_contents->data + ((*(unsigned short*)&_contents->data[2]) << 1);
+	int shift = numerator.bitLength() - denominator.bitLength() - 53;
+	if (shift < DOUBLE_MIN_EXPONENT)
+		shift = DOUBLE_MIN_EXPONENT;
+	int half;
+	unsigned __int64 q = divide(numerator, denominator, shift, &half);
+	if (q >= 2 * HIDDEN_BIT) {
+		shift++;
+		q = divide(numerator, denominator, shift, &half);
+	}
+	if (half > 0 || (half == 0 && (truncated || (q & 1))))
+		q++;
+	if (q == 2 * HIDDEN_BIT) {
+		q >>= 1;
+		shift++;
+	}
+	if (shift > DOUBLE_MAX_EXPONENT)
+		return infinity();
+	return ldexp((double)q, shift);
+}
+/*
+ *	parseSpecial
+ *
+ *	Reads inf, infinity or nan, in any case.
+ *
+ *	RETURNS:
+ *		The number of characters used, or 0 if there is no such word.
+ */
+static int parseSpecial(const char* text, int length, bool negative, double* value) {
+	if (length >= 3 && string::equalsIgnoreCase(text, "nan", 3)) {
+		*value = notANumber();
+		return 3;
+	}
+	if (length >= 3 && string::equalsIgnoreCase(text, "inf", 3)) {
+		*value = negative ? -infinity() : infinity();
+		if (length >= 8 && string::equalsIgnoreCase(text, "infinity", 8))
+			return 8;
+		return 3;
+	}
+	return 0;
+}
 
-	default:
-		for (int i = 0; i < _contents->length; i++)
-			v += _contents->data[i] << (i & 7);
+int parse(const char* text, int length, double* value) {
+	int i = 0;
+	while (i < length && isSpace(text[i]))
+		i++;
+	bool negative = false;
+	if (i < length && (text[i] == '-' || text[i] == '+')) {
+		negative = text[i] == '-';
+		i++;
 	}
-	return v;
+	int mantissaStart = i;
+	unsigned __int64 m = 0;
+	int digits = 0;				// significant digits in m
+	int exponent = 0;
+	bool truncated = false;		// non-zero digits were dropped
+	bool anyDigits = false;
+	for (; i < length && isDigit(text[i]); i++) {
+		anyDigits = true;
+		if (digits < MAX_MANTISSA_DIGITS) {
+			m = m * 10 + (text[i] - '0');
+			if (m)
+				digits++;
+		} else {
+			exponent++;
+			if (text[i] != '0')
+				truncated = true;
+		}
+	}
+	if (i < length && text[i] == '.') {
+		for (i++; i < length && isDigit(text[i]); i++) {
+			anyDigits = true;
+			if (digits < MAX_MANTISSA_DIGITS) {
+				m = m * 10 + (text[i] - '0');
+				if (m)
+					digits++;
+				exponent--;
+			} else if (text[i] != '0')
+				truncated = true;
+		}
+	}
+	if (!anyDigits) {
+		int n = parseSpecial(text + mantissaStart, length - mantissaStart, negative, value);
+		if (n)
+			return mantissaStart + n;
+		*value = 0;
+		return 0;
+	}
+	int mantissaEnd = i;
+	int explicitExponent = 0;
+	if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+		int j = i + 1;
+		bool negativeExponent = false;
+		if (j < length && (text[j] == '-' || text[j] == '+')) {
+			negativeExponent = text[j] == '-';
+			j++;
+		}
+		if (j < length && isDigit(text[j])) {
+			int e = 0;
+			for (; j < length && isDigit(text[j]); j++)
+				if (e < 100000)
+					e = e * 10 + (text[j] - '0');
+			if (negativeExponent)
+				explicitExponent = -e;
+			else
+				explicitExponent = e;
+			exponent += explicitExponent;
+			i = j;
+		}
+	}
+	double x;
+	if (m == 0)
+		x = 0;
+	else if (!truncated && m <= (unsigned __int64)MAX_EXACT_INTEGER &&
+			 exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER) {
+		x = (double)m;
+		if (exponent < 0)
+			x /= POWERS_OF_TEN[-exponent];
+		else
+			x *= POWERS_OF_TEN[exponent];
+	} else if (digits + exponent > 310)
+		x = infinity();
+	else if (digits + exponent < -324)
+		x = 0;
+	else if (!estimate(m, digits, exponent, truncated, &x))
+		x = parseExactly(text + mantissaStart, mantissaEnd - mantissaStart, explicitExponent);
+	if (negative)
+		x = -x;
+	*value = x;
+	return i;
 }
+
+}  // namespace number
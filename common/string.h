@@ -5,63 +5,130 @@
 #include "vector.h"
 #define null 0
 
+class splitIterator;
+class stringSlice;
+/*
+ *	number
+ *
+ *	The one place numbers are converted to and from text.  Nothing here
+ *	depends on the C locale, allocates memory or takes a lock.
+ *
+ *	A double is formatted with the fewest significant digits that read
+ *	back as exactly the same value, and of those the closest to it.  As
+ *	with %g, magnitudes from 0.0001 up to (but not including) 10^17 come
+ *	out in plain decimal notation, others in exponent notation, such as
+ *	2.5e-07 or 1e+300.  Infinities and NaNs are written as inf, -inf and
+ *	nan.
+ *
+ *	A double is parsed to the nearest value, ties to even, whatever the
+ *	number of digits.  Most text is settled in 64 bit arithmetic; only
+ *	values within a hair of a tie fall back to exact integer arithmetic
+ *	on the stack.
+ */
+namespace number {
+
+const int MAX_LENGTH = 32;			// buffer size that holds any formatted number and its null
+/*
+ *	format
+ *
+ *	Writes 'v' to 'buffer', which must hold at least MAX_LENGTH
+ *	characters, and null terminates it.
+ *
+ *	RETURNS:
+ *		The number of characters written, not counting the null.
+ */
+int format(char* buffer, int v);
+int format(char* buffer, unsigned v);
+int format(char* buffer, __int64 v);
+int format(char* buffer, unsigned __int64 v);
+int format(char* buffer, double x);
+/*
+ *	parse
+ *
+ *	Reads a number from the start of the 'length' characters at 'text',
+ *	after any white space.  Integers are read as atoi would read them;
+ *	doubles as strtod would in the C locale, including inf, infinity and
+ *	nan in any case, but not hexadecimal.  If there is no number, *value
+ *	is zero.
+ *
+ *	RETURNS:
+ *		The number of characters used, or 0 if there is no number.
+ */
+int parse(const char* text, int length, int* value);
+int parse(const char* text, int length, double* value);
+
+}  // namespace number
+/*
+ *	string
+ *
+ *	Values of up to SHORT_CAPACITY characters are stored inside the
+ *	object itself.  Only longer values are copied to a heap allocation,
+ *	so short identifiers, tags and numbers never touch malloc.
+ */
 class string {
 public:
-	string() : _contents(0) {
+	string() {
+		setEmpty();
 	}
 
-	string(const char* value) : _contents(0) {
+	string(const char* value) {
+		setEmpty();
 		size_t len = strlen(value);
 		if (len) {
 			resize((int)len);
-			memcpy(_contents->data, value, len + 1);
+			memcpy(storage(), value, len + 1);
 		}
 	}
 
-	string(const string& value) : _contents(0) {
+	string(const string& value) {
+		setEmpty();
 		if (value.size()) {
 			resize(value.size());
-			memcpy(_contents->data, value._contents->data, value._contents->length + 1);
+			memcpy(storage(), value.c_str(), value.size() + 1);
 		}
 	}
 
-	string(int v) : _contents(0) {
-		char buffer[32];
-		sprintf(buffer, "%d", v);
-		size_t len = strlen(buffer);
-		resize((int)len);
-		memcpy(_contents->data, buffer, len + 1);
+	string(string&& value) {
+		takeFrom(value);
 	}
 
-	string(unsigned long v) : _contents(0) {
-		char buffer[32];
-		sprintf(buffer, "%lu", v);
-		size_t len = strlen(buffer);
-		resize((int)len);
-		memcpy(_contents->data, buffer, len + 1);
+	string(int v) {
+		setEmpty();
+		char buffer[number::MAX_LENGTH];
+		int len = number::format(buffer, v);
+		resize(len);
+		memcpy(storage(), buffer, len + 1);
 	}
 
-	string(double x) : _contents(0) {
-		char buffer[32];
-		sprintf(buffer, "%g", x);
-		size_t len = strlen(buffer);
-		resize((int)len);
-		memcpy(_contents->data, buffer, len + 1);
+	string(unsigned long v) {
+		setEmpty();
+		char buffer[number::MAX_LENGTH];
+		int len = number::format(buffer, (unsigned __int64)v);
+		resize(len);
+		memcpy(storage(), buffer, len + 1);
 	}
 
-	string(const char* value, int len) : _contents(0) {
+	string(double x) {
+		setEmpty();
+		char buffer[number::MAX_LENGTH];
+		int len = number::format(buffer, x);
+		resize(len);
+		memcpy(storage(), buffer, len + 1);
+	}
+
+	string(const char* value, int len) {
+		setEmpty();
 		if (len) {
 			resize(len);
-			memcpy(_contents->data, value, len);
-			_contents->data[len] = 0;
+			memcpy(storage(), value, len);
 		}
 	}
 
-	string(const vector<char> &value) : _contents(0) {
+	string(const vector<char> &value) {
+		setEmpty();
 		if (value.size()) {
 			resize(value.size());
-			memcpy(_contents->data, &value[0], value.size());
-			_contents->data[value.size()] = 0;
+			memcpy(storage(), &value[0], value.size());
 		}
 	}
 
@@ -70,25 +137,30 @@ public:
 	}
 
 	int size() const {
-		if (_contents)
-			return _contents->length;
+		if (_short.length != ON_HEAP)
+			return _short.length;
 		else
-			return 0;
+			return _contents->length;
 	}
 
 	void clear() {
-		if (_contents)
+		if (_short.length == ON_HEAP)
 			free(_contents);
-		_contents = 0;
+		setEmpty();
 	}
-
+	/*
+	 *	resize
+	 *
+	 *	Sets the length of the string.  Any characters added are
+	 *	uninitialized, but the string is always null terminated.
+	 */
 	void resize(int length);
 
 	const char* c_str() const {
-		if (_contents)
-			return _contents->data;
+		if (_short.length != ON_HEAP)
+			return _short.text;
 		else
-			return "";
+			return _contents->data;
 	}
 
 	string& append(const string& s) {
@@ -96,7 +168,7 @@ public:
 		if (length) {
 			int old_size = size();
 			resize(old_size + (int)length);
-			memcpy(&_contents->data[old_size], s.c_str(), length + 1);
+			memcpy(storage() + old_size, s.c_str(), length + 1);
 		}
 		return *this;
 	}
@@ -105,15 +177,14 @@ public:
 		size_t len = strlen(s);
 		int old_size = size();
 		resize(old_size + (int)len);
-		memcpy(&_contents->data[old_size], s, len + 1);
+		memcpy(storage() + old_size, s, len + 1);
 		return *this;
 	}
 
 	string& append(const char* s, int length) {
 		int old_size = size();
 		resize(old_size + length);
-		memcpy(&_contents->data[old_size], s, length);
-		_contents->data[old_size + length] = 0;
+		memcpy(storage() + old_size, s, length);
 		return *this;
 	}
 	/*
@@ -129,6 +200,15 @@ public:
 	 *	The delimiter characters are not included in the output.
 	 */
 	void split(char delimiter, vector<string>* output) const;
+	/*
+	 *	split
+	 *
+	 *	Returns an iterator over the same tokens that the vector form
+	 *	of split produces, as slices of this string.  Nothing is
+	 *	allocated.  The string must outlive the iterator and must not
+	 *	be modified while it is in use.
+	 */
+	splitIterator split(char delimiter) const;
 
 	int printf(const char* format, ...);
 
@@ -142,8 +222,12 @@ public:
 	 *	wrapped with double-quotes would be a well-formed C
 	 *	string literal token with the same string value as 
 	 *	this object.
+	 *
+	 *	Clean text is found 16 bytes at a time, so a string that needs
+	 *	no escapes is just copied, and any other is written into an
+	 *	output sized in advance.
 	 */
-	string escapeC();
+	string escapeC() const;
 	/*
 	 *	unescapeC
 	 *
@@ -162,7 +246,7 @@ public:
 	 *		\\		\
 	 *
 	 */
-	bool unescapeC(string* output);
+	bool unescapeC(string* output) const;
 
 	string trim() const;
 
@@ -173,30 +257,153 @@ public:
 	bool toBool() const;
 
 	void push_back(char c) {
-		resize(size() + 1);
-		_contents->data[_contents->length - 1] = c;
-		_contents->data[_contents->length] = 0;
+		int old_size = size();
+		resize(old_size + 1);
+		storage()[old_size] = c;
 	}
 
 	int find(char c, int offset = 0) const {
-		for (int i = offset; i < size(); i++) {
-			if (_contents->data[i] == c)
-				return i;
-		}
-		return npos;
+		if (offset >= size())
+			return npos;
+		const char* text = c_str();
+		const char* cp = (const char*)memchr(text + offset, c, size() - offset);
+		if (cp)
+			return (int)(cp - text);
+		else
+			return npos;
+	}
+	/*
+	 *	find
+	 *
+	 *	RETURNS:
+	 *		The offset of the first occurrence of 'key' that starts at or
+	 *		after 'offset', or npos if there is none.
+	 */
+	int find(const string& key, int offset = 0) const {
+		if (offset > size())
+			return npos;
+		int i = search(c_str() + offset, size() - offset, key.c_str(), key.size());
+		if (i == npos)
+			return npos;
+		else
+			return offset + i;
 	}
 
 	int rfind(char c, int offset = npos) const {
 		if (offset == npos)
 			offset = size();
+		const char* text = c_str();
 		for (int i = offset - 1; i >= 0; i--) {
-			if (_contents->data[i] == c)
+			if (text[i] == c)
 				return i;
 		}
 		return npos;
 	}
+	/*
+	 *	rfind
+	 *
+	 *	RETURNS:
+	 *		The offset of the last occurrence of 'key' that starts before
+	 *		'offset' (anywhere, if 'offset' is npos), or npos if there is
+	 *		none.
+	 */
+	int rfind(const string& key, int offset = npos) const;
+
+	bool contains(const string& key) const {
+		return find(key) != npos;
+	}
+	/*
+	 *	findFirstOf
+	 *
+	 *	RETURNS:
+	 *		The offset of the first character at or after 'offset' that
+	 *		appears anywhere in 'set', or npos if there is none.
+	 */
+	int findFirstOf(const string& set, int offset = 0) const {
+		if (offset >= size())
+			return npos;
+		int i = findFirstOf(c_str() + offset, size() - offset, set.c_str(), set.size());
+		if (i == npos)
+			return npos;
+		else
+			return offset + i;
+	}
+	/*
+	 *	findFirstOf
+	 *
+	 *	Scans the 'length' bytes at 'text' for any of the 'setLength'
+	 *	bytes at 'set'.  Sets of up to 16 bytes are checked against
+	 *	16 bytes of text at a time with SSE2.
+	 *
+	 *	RETURNS:
+	 *		The offset in 'text' of the first byte found, or npos.
+	 */
+	static int findFirstOf(const char* text, int length, const char* set, int setLength);
+	/*
+	 *	count
+	 *
+	 *	RETURNS:
+	 *		The number of non-overlapping occurrences of 'key'.
+	 */
+	int count(const string& key) const;
+	/*
+	 *	search
+	 *
+	 *	Finds the first occurrence of the 'keyLength' bytes at 'key' in
+	 *	the 'length' bytes at 'text'.  Neither need be null terminated.
+	 *
+	 *	Short keys are found by comparing the first and last bytes of
+	 *	the key against 16 candidate positions at a time with SSE2 (one
+	 *	at a time without it) and calling memcmp only where both match.
+	 *	Long keys use the two-way algorithm, which never takes more than
+	 *	linear time, however repetitive the text and key are.
+	 *
+	 *	RETURNS:
+	 *		The offset in 'text' of the match, or npos if there is none.
+	 */
+	static int search(const char* text, int length, const char* key, int keyLength);
+
+	/*
+	 *	tolower
+	 *
+	 *	The same as toLowerAscii: in the C locale ::tolower only maps
+	 *	ASCII letters too.
+	 */
+	string tolower() const {
+		return toLowerAscii();
+	}
+	/*
+	 *	toLowerAscii, toUpperAscii
+	 *
+	 *	Return a copy with the ASCII letters mapped to lower (or upper)
+	 *	case.  Other bytes, including any above 0x7f, are unchanged.
+	 *	Case mapping, comparison and hashing in this family work 16
+	 *	bytes at a time with SSE2.
+	 */
+	string toLowerAscii() const;
+
+	string toUpperAscii() const;
 
-	string tolower() const;
+	bool equalsIgnoreCase(const string& s2) const {
+		return size() == s2.size() && equalsIgnoreCase(c_str(), s2.c_str(), size());
+	}
+	/*
+	 *	compareIgnoreCase
+	 *
+	 *	Compares like compare, but as if both strings were first mapped
+	 *	to lower case with toLowerAscii.
+	 */
+	int compareIgnoreCase(const string& s2) const;
+
+	static bool equalsIgnoreCase(const char* a, const char* b, int length);
+	/*
+	 *	compareIgnoreCase
+	 *
+	 *	RETURNS:
+	 *		Like memcmp, but for the 'length' bytes at 'a' and 'b'
+	 *		mapped to lower case.
+	 */
+	static int compareIgnoreCase(const char* a, const char* b, int length);
 
 	string substr(int offset = 0, int count = npos) const {
 		if (offset > size())
@@ -208,47 +415,47 @@ public:
 		string result;
 		if (count) {
 			result.resize(count);
-			memcpy(result._contents->data, _contents->data + offset, count);
-			result._contents->data[count] = 0;
+			memcpy(result.storage(), c_str() + offset, count);
 		}
 		return result;
 	}
+	/*
+	 *	slice
+	 *
+	 *	Like substr, but refers to the characters in place rather than
+	 *	copying them.  The slice is valid only as long as this string
+	 *	is neither modified nor destroyed.
+	 */
+	stringSlice slice(int offset = 0, int count = npos) const;
 
 	char* buffer_(int len) {
 		resize(len);
-		return _contents->data;
+		return storage();
 	}
 
 	char& operator [](int i) {
-		if (_contents)
-			return _contents->data[i];
-		else
-			return dummy;
+		return storage()[i];
 	}
 
 	const char& operator [] (int i) const {
-		if (_contents)
-			return _contents->data[i];
-		else
-			return dummy;
+		return c_str()[i];
 	}
 
 	string operator + (const string& s2) const {
 		string result;
 
 		result.resize(size() + s2.size());
-		if (size())
-			memcpy(result._contents->data, _contents->data, _contents->length);
-		if (s2.size())
-			memcpy(result._contents->data + size(), s2._contents->data, s2._contents->length + 1);
+		memcpy(result.storage(), c_str(), size());
+		memcpy(result.storage() + size(), s2.c_str(), s2.size() + 1);
 		return result;
 	}
 
-	string operator += (const string& s2) {
-		resize(size() + s2.size());
-		if (s2.size())
-			memcpy(_contents->data + _contents->length, s2._contents->data, s2._contents->length + 1);
-		return *this;
+	string& operator += (const string& s2) {
+		return append(s2);
+	}
+
+	string& operator += (const char* s2) {
+		return append(s2);
 	}
 
 	bool operator == (const string& s2) const {
@@ -285,12 +492,20 @@ public:
 			clear();
 			if (s.size()) {
 				resize(s.size());
-				memcpy(_contents->data, s._contents->data, s._contents->length + 1);
+				memcpy(storage(), s.c_str(), s.size() + 1);
 			}
 		}
 		return *this;
 	}
 
+	string& operator= (string&& s) {
+		if (this != &s) {
+			clear();
+			takeFrom(s);
+		}
+		return *this;
+	}
+
 	int compare(const string* other) const {
 		int n;
 
@@ -313,30 +528,381 @@ public:
 
 	unsigned asHex() const;
 
-	int hashValue() const;
+	/*
+	 *	hashValue
+	 *
+	 *	The hash of a heap allocated string is computed once and kept
+	 *	in the allocation until the string is next modified, so the
+	 *	same key string can be looked up repeatedly at no hashing cost.
+	 */
+	int hashValue() const {
+		if (_short.length != ON_HEAP)
+			return hashValue(_short.text, _short.length);
+		if (_contents->hash == UNHASHED)
+			_contents->hash = hashValue(_contents->data, _contents->length);
+		return _contents->hash;
+	}
+	/*
+	 *	hashValue
+	 *
+	 *	Hashes 'length' bytes at 'data' exactly as the hashValue
+	 *	method would hash a string with the same contents.  Hash
+	 *	tables use this to probe with text they do not own.
+	 */
+	static int hashValue(const char* data, int length);
+
+	int hashValueIgnoreCase() const {
+		return hashValueIgnoreCase(c_str(), size());
+	}
+	/*
+	 *	hashValueIgnoreCase
+	 *
+	 *	Hashes the 'length' bytes at 'data' as hashValue would hash
+	 *	them after toLowerAscii, without making the lower case copy.
+	 */
+	static int hashValueIgnoreCase(const char* data, int length);
 
 	static const int npos = -1;
 
 private:
-	static char dummy;
 	static const int MIN_SIZE = 0x10;
+	static const int SHORT_CAPACITY = 22;
+	static const signed char ON_HEAP = -1;
+	static const int UNHASHED = 0;				// a true hash of 0 is just recomputed
 
 	struct allocation {
 		int length;
+		int hash;								// or UNHASHED
 		char data[1];
 	};
 
+	void setEmpty() {
+		_short.text[0] = 0;
+		_short.length = 0;
+	}
+
+	/*
+	 *	storage
+	 *
+	 *	Returns the text for writing, so any cached hash is dropped.
+	 */
+	char* storage() {
+		if (_short.length != ON_HEAP)
+			return _short.text;
+		_contents->hash = UNHASHED;
+		return _contents->data;
+	}
+	/*
+	 *	takeFrom
+	 *
+	 *	Steals the value of 's', leaving it empty.  _short spans the
+	 *	whole union, so copying it carries a heap pointer along too.
+	 */
+	void takeFrom(string& s) {
+		_short = s._short;
+		s.setEmpty();
+	}
+
 	int reserved_size(int length) {
-		int used_size = length + sizeof (int) + 1;
+		int used_size = length + sizeof (allocation);
 		int alloc_size = MIN_SIZE;
 		while (alloc_size < used_size)
 			alloc_size <<= 1;
 		return alloc_size;
 	}
 
-	allocation* _contents;
+	union {
+		allocation*		_contents;						// when _short.length == ON_HEAP
+		struct {
+			char		text[SHORT_CAPACITY + 1];		// null terminated
+			signed char	length;							// or ON_HEAP
+		}				_short;
+	};
+};
+
+template<>
+struct isRelocatable<string> {
+	static const bool value = true;
 };
 
+/*
+ *	stringSlice
+ *
+ *	A non-owning view of a run of characters: a pointer and a length.
+ *	The text need not be null terminated, and whatever owns it must
+ *	outlive the slice.  Copying a slice never allocates.
+ */
+class stringSlice {
+public:
+	stringSlice() {
+		_text = "";
+		_length = 0;
+	}
+
+	stringSlice(const char* text, int length) {
+		_text = text;
+		_length = length;
+	}
+
+	stringSlice(const char* text) {
+		_text = text;
+		_length = (int)strlen(text);
+	}
+
+	stringSlice(const string& s) {
+		_text = s.c_str();
+		_length = s.size();
+	}
+
+	const char* text() const { return _text; }
+
+	int size() const { return _length; }
+
+	const char& operator [] (int i) const {
+		return _text[i];
+	}
+
+	string toString() const {
+		return string(_text, _length);
+	}
+
+	stringSlice slice(int offset = 0, int count = string::npos) const {
+		if (offset > _length)
+			offset = _length;
+		if (count == string::npos || count > _length - offset)
+			count = _length - offset;
+		return stringSlice(_text + offset, count);
+	}
+
+	int find(char c, int offset = 0) const {
+		if (offset >= _length)
+			return string::npos;
+		const char* cp = (const char*)memchr(_text + offset, c, _length - offset);
+		if (cp)
+			return (int)(cp - _text);
+		else
+			return string::npos;
+	}
+
+	int find(const stringSlice& key, int offset = 0) const {
+		if (offset > _length)
+			return string::npos;
+		int i = string::search(_text + offset, _length - offset, key._text, key._length);
+		if (i == string::npos)
+			return string::npos;
+		else
+			return offset + i;
+	}
+
+	stringSlice trim() const;
+
+	int toInt() const;
+
+	double toDouble() const;
+
+	int hashValue() const {
+		return string::hashValue(_text, _length);
+	}
+
+	bool operator == (const stringSlice& s2) const {
+		if (_length != s2._length)
+			return false;
+		return memcmp(_text, s2._text, _length) == 0;
+	}
+
+	bool operator != (const stringSlice& s2) const {
+		return !(*this == s2);
+	}
+
+	bool operator < (const stringSlice& s2) const {
+		return compare(s2) < 0;
+	}
+
+	int compare(const stringSlice& other) const {
+		int n;
+
+		if (_length < other._length)
+			n = _length;
+		else
+			n = other._length;
+		int r = memcmp(_text, other._text, n);
+		if (r != 0)
+			return r;
+		else
+			return _length - other._length;
+	}
+
+private:
+	const char*		_text;
+	int				_length;
+};
+/*
+ *	splitIterator
+ *
+ *	Walks the delimited tokens of a slice:
+ *
+ *		for (splitIterator i = s.split(','); i.valid(); i.next())
+ *			process(*i);
+ *
+ *	Like the vector form of string::split, there is always one more
+ *	token than there are delimiters, so an empty text has exactly one,
+ *	empty, token.
+ */
+class splitIterator {
+public:
+	splitIterator(const stringSlice& text, char delimiter) {
+		_next = text.text();
+		_end = _next + text.size();
+		_delimiter = delimiter;
+		next();
+	}
+
+	bool valid() const {
+		return _token.text() != null;
+	}
+
+	void next() {
+		if (_next == null) {
+			_token = stringSlice(null, 0);
+			return;
+		}
+		const char* cp = (const char*)memchr(_next, _delimiter, _end - _next);
+		if (cp) {
+			_token = stringSlice(_next, (int)(cp - _next));
+			_next = cp + 1;
+		} else {
+			_token = stringSlice(_next, (int)(_end - _next));
+			_next = null;
+		}
+	}
+
+	const stringSlice& operator* () const {
+		return _token;
+	}
+
+	const stringSlice* operator-> () const {
+		return &_token;
+	}
+
+private:
+	stringSlice		_token;
+	const char*		_next;				// start of the token after _token, null after the last
+	const char*		_end;
+	char			_delimiter;
+};
+
+inline stringSlice string::slice(int offset, int count) const {
+	return stringSlice(*this).slice(offset, count);
+}
+
+inline splitIterator string::split(char delimiter) const {
+	return splitIterator(*this, delimiter);
+}
+
 string operator+ (const char* left, const string& right);
+/*
+ *	operator+
+ *
+ *	When the left operand is a temporary, as in every link after the
+ *	first of a chain like a + b + c, the right operand is appended
+ *	to it in place, so the chain grows one buffer instead of
+ *	allocating a fresh result at each step.
+ */
+inline string operator+ (string&& left, const string& right) {
+	left.append(right);
+	return static_cast<string&&>(left);
+}
+
+inline string operator+ (string&& left, const char* right) {
+	left.append(right);
+	return static_cast<string&&>(left);
+}
+/*
+ *	StringBuilder
+ *
+ *	Accumulates text for a string that is built in many pieces, such
+ *	as a log line or a path.  Give the constructor a good estimate of
+ *	the final size and the whole value is built in one allocation,
+ *	which toString then hands over without copying.
+ */
+class StringBuilder {
+public:
+	StringBuilder(int capacity = 0) {
+		_length = 0;
+		if (capacity)
+			_text.resize(capacity);
+	}
+
+	StringBuilder& append(const string& s) {
+		return append(s.c_str(), s.size());
+	}
+
+	StringBuilder& append(const char* s) {
+		return append(s, (int)strlen(s));
+	}
+
+	StringBuilder& append(const char* s, int length) {
+		memcpy(extend(length), s, length);
+		return *this;
+	}
+
+	StringBuilder& append(char c) {
+		*extend(1) = c;
+		return *this;
+	}
+
+	StringBuilder& append(int v) {
+		char* output = extend(number::MAX_LENGTH);
+		_length -= number::MAX_LENGTH - number::format(output, v);
+		return *this;
+	}
+
+	StringBuilder& append(unsigned v) {
+		char* output = extend(number::MAX_LENGTH);
+		_length -= number::MAX_LENGTH - number::format(output, v);
+		return *this;
+	}
+
+	StringBuilder& append(double x) {
+		char* output = extend(number::MAX_LENGTH);
+		_length -= number::MAX_LENGTH - number::format(output, x);
+		return *this;
+	}
+
+	template<class A>
+	StringBuilder& operator << (const A& a) {
+		return append(a);
+	}
+
+	int size() const { return _length; }
+	/*
+	 *	toString
+	 *
+	 *	RETURNS:
+	 *		The accumulated text.  The builder is left empty.
+	 */
+	string toString() {
+		_text.resize(_length);
+		_length = 0;
+		return static_cast<string&&>(_text);
+	}
+
+private:
+	char* extend(int length) {
+		int needed = _length + length;
+		if (needed > _text.size()) {
+			int capacity = _text.size() * 2;
+			if (capacity < needed)
+				capacity = needed;
+			_text.resize(capacity);
+		}
+		char* output = &_text[_length];
+		_length = needed;
+		return output;
+	}
+
+	string	_text;					// _text.size() is the capacity
+	int		_length;
+};
 
 int compare(const string& ref, const char* text, int length);
@@ -0,0 +1,135 @@
+#include "../common/platform.h"
+#include "symbol.h"
+
+#include <atomic>
+#include "map.h"
+#include "process.h"
+/*
+ *	SymbolTable
+ *
+ *	The intern table: an open addressed array of pointers to the
+ *	permanent copies of the names, probed linearly from the hash of the
+ *	text.  It is never more than half full.
+ *
+ *	Lookups take no lock.  A slot only ever changes from null to a name,
+ *	and a grown table is completely filled before it is published, so a
+ *	reader either finds a name or sees a table that does not have it yet
+ *	and takes the lock to make sure.  A replaced table is never freed,
+ *	since some reader may still be probing it; together the old tables
+ *	are smaller than the current one.
+ */
+struct SymbolTable {
+	struct Slot {
+		std::atomic<const string*>	name;
+		int							hash;		// written before name is published
+	};
+
+	int			mask;
+	Slot*		slots;
+
+	SymbolTable(int capacity) {
+		mask = capacity - 1;
+		slots = new Slot[capacity]();
+	}
+	/*
+	 *	lookup
+	 *
+	 *	RETURNS:
+	 *		The permanent copy of the 'length' bytes at 'name', or null
+	 *		if this table does not have one.
+	 */
+	const string* lookup(const char* name, int length, int hash) const {
+		for (int i = hash & mask; ; i = (i + 1) & mask) {
+			const string* s = slots[i].name.load(std::memory_order_acquire);
+			if (s == null)
+				return null;
+			if (slots[i].hash == hash && s->size() == length && memcmp(s->c_str(), name, length) == 0)
+				return s;
+		}
+	}
+	/*
+	 *	add
+	 *
+	 *	Stores 's', which hashes to 'hash' and must not be in the table,
+	 *	in the first free slot along its probe sequence.  The caller
+	 *	holds the lock.
+	 */
+	void add(const string* s, int hash) {
+		int i = hash & mask;
+		while (slots[i].name.load(std::memory_order_relaxed) != null)
+			i = (i + 1) & mask;
+		slots[i].hash = hash;
+		slots[i].name.store(s, std::memory_order_release);
+	}
+};
+
+static const int INITIAL_CAPACITY = 256;
+
+static process::Mutex lock;
+static std::atomic<SymbolTable*> table;
+static int symbolCount;						// guarded by lock
+
+bool Symbol::find(const char* name, int length, Symbol* output) {
+	if (length == 0) {
+		output->_name = emptyName();
+		return true;
+	}
+	const SymbolTable* t = table.load(std::memory_order_acquire);
+	if (t == null)
+		return false;
+	const string* s = t->lookup(name, length, string::hashValue(name, length));
+	if (s == null)
+		return false;
+	output->_name = s;
+	return true;
+}
+
+int Symbol::hashValue() const {
+	return (int)hashTable::hashPointer(_name);
+}
+
+const string* Symbol::intern(const char* name, int length) {
+	if (length == 0)
+		return emptyName();
+	int hash = string::hashValue(name, length);
+	const SymbolTable* t = table.load(std::memory_order_acquire);
+	if (t != null) {
+		const string* s = t->lookup(name, length, hash);
+		if (s != null)
+			return s;
+	}
+	process::MutexLock m(&lock);
+	SymbolTable* current = table.load(std::memory_order_relaxed);
+	if (current != null) {
+		const string* s = current->lookup(name, length, hash);
+		if (s != null)
+			return s;
+	}
+	if (current == null || 2 * (symbolCount + 1) > current->mask + 1) {
+		SymbolTable* grown = new SymbolTable(current ? 2 * (current->mask + 1) : INITIAL_CAPACITY);
+		if (current != null) {
+			for (int i = 0; i <= current->mask; i++) {
+				const string* s = current->slots[i].name.load(std::memory_order_relaxed);
+				if (s != null)
+					grown->add(s, current->slots[i].hash);
+			}
+		}
+		table.store(grown, std::memory_order_release);
+		current = grown;
+	}
+	const string* s = new string(name, length);
+	current->add(s, hash);
+	symbolCount++;
+	return s;
+}
+/*
+ *	emptyName
+ *
+ *	The empty string is not kept in the table, so that default
+ *	constructed Symbols, including static ones, need no lock and
+ *	do not depend on the table having been constructed yet.
+ */
+const string* Symbol::emptyName() {
+	static string empty;
+	return &empty;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "string.h"
+/*
+ *	Symbol
+ *
+ *	A handle on an interned string.  All Symbols made from the same
+ *	text share a single, permanent copy of it, so two Symbols are equal
+ *	exactly when they point to the same copy, and hashing a Symbol is a
+ *	matter of hashing that pointer.  Tables keyed by Symbols (for example
+ *	a map<const string, B> keyed by Symbol::key()) never compare text.
+ *
+ *	Interned text is never freed, so only names drawn from a small,
+ *	slowly growing vocabulary (element tags, attribute and property
+ *	names) should be interned, not arbitrary text.
+ *
+ *	The intern table is shared by all threads.  Only adding a name to
+ *	it takes a lock: finding or making a Symbol for a name that is
+ *	already interned, and copying, comparing and reading a Symbol, do
+ *	not.
+ *
+ *	A default constructed Symbol is the empty string.
+ */
+class Symbol {
+public:
+	Symbol() {
+		_name = emptyName();
+	}
+
+	explicit Symbol(const string& name) {
+		_name = intern(name.c_str(), name.size());
+	}
+
+	explicit Symbol(const char* name) {
+		_name = intern(name, strlen(name));
+	}
+
+	Symbol(const char* name, int length) {
+		_name = intern(name, length);
+	}
+	/*
+	 *	find
+	 *
+	 *	Looks up 'name' without adding it to the table.  A name that
+	 *	was never interned cannot equal any Symbol, so callers that
+	 *	only compare against existing Symbols can use find and skip
+	 *	growing the table with text they were merely asked about.
+	 *
+	 *	RETURNS:
+	 *		true - if 'name' has been interned, with *output set to
+	 *		its Symbol.
+	 *		false - if it has not, *output is unchanged.
+	 */
+	static bool find(const string& name, Symbol* output) {
+		return find(name.c_str(), name.size(), output);
+	}
+
+	static bool find(const char* name, int length, Symbol* output);
+
+	const string& toString() const { return *_name; }
+
+	const char* c_str() const { return _name->c_str(); }
+
+	int size() const { return _name->size(); }
+	/*
+	 *	key
+	 *
+	 *	RETURNS:
+	 *		The address of the shared copy of the text, which is the
+	 *		same for every Symbol of the same name.
+	 */
+	const string* key() const { return _name; }
+
+	int hashValue() const;
+
+	bool operator == (const Symbol& other) const {
+		return _name == other._name;
+	}
+
+	bool operator != (const Symbol& other) const {
+		return _name != other._name;
+	}
+
+	bool operator == (const string& s) const {
+		return *_name == s;
+	}
+
+	bool operator != (const string& s) const {
+		return *_name != s;
+	}
+
+	bool operator == (const char* s) const {
+		return strcmp(_name->c_str(), s) == 0;
+	}
+
+	bool operator != (const char* s) const {
+		return strcmp(_name->c_str(), s) != 0;
+	}
+
+	operator const string& () const {
+		return *_name;
+	}
+
+private:
+	static const string* intern(const char* name, int length);
+
+	static const string* emptyName();
+
+	const string*	_name;
+};
@@ -1,7 +1,52 @@
 #pragma once
+#include <new>
+#include <stdlib.h>
+#include <string.h>
 #define null 0
 
+/*
+ *	isRelocatable
+ *
+ *	A type is relocatable if an object can be moved to a new address
+ *	with a plain memcpy, after which the old copy is simply forgotten
+ *	(its destructor is not run).  A vector of relocatable elements grows
+ *	with realloc, without constructing or destroying anything.
+ *
+ *	Scalars, pointers and POD structs are relocatable.  A class that
+ *	only holds pointers to heap storage it owns (string, vector) is
+ *	also relocatable, and says so with a specialization.
+ */
 template<class A>
+struct isRelocatable {
+	static const bool value = __is_pod(A);
+};
+
+template<class A, int MIN_SIZE>
+class vector;
+
+template<class A, int M>
+void sort(vector<A*, M>* a, int min, int max, bool ascending);
+
+template<class A, int M>
+void sort(vector<A, M>* a, int min, int max, bool ascending);
+
+template<class A, int M, class Compare>
+void sort(vector<A, M>* a, Compare compare);
+
+template<class A, int M, class Compare>
+void stableSort(vector<A, M>* a, Compare compare);
+
+#pragma push_macro("new")
+#undef new
+/*
+ *	vector
+ *
+ *	A growable array.  Storage is allocated in power-of-two blocks
+ *	of no fewer than MIN_SIZE elements.  Vectors that are expected to
+ *	stay small can lower MIN_SIZE, or use smallVector (below) to keep
+ *	the first few elements inside the object itself.
+ */
+template<class A, int MIN_SIZE = 0x10>
 class vector {
 public:
 	vector(int initialSize) {
@@ -17,17 +62,59 @@ public:
 		_allocatedCount = 0;
 	}
 
+	vector(const vector<A, MIN_SIZE>& source) {
+		_elements = null;
+		_elementCount = 0;
+		_allocatedCount = 0;
+		copyFrom(source);
+	}
+
+	vector(vector<A, MIN_SIZE>&& source) {
+		_elements = null;
+		_elementCount = 0;
+		_allocatedCount = 0;
+		takeFrom(source);
+	}
+
 	~vector() {
-		delete [] (A*)_elements;
+		clear();
+	}
+
+	vector<A, MIN_SIZE>& operator= (const vector<A, MIN_SIZE>& source) {
+		if (this != &source) {
+			clear();
+			copyFrom(source);
+		}
+		return *this;
+	}
+
+	vector<A, MIN_SIZE>& operator= (vector<A, MIN_SIZE>&& source) {
+		if (this != &source) {
+			clear();
+			takeFrom(source);
+		}
+		return *this;
 	}
 
 	int size() const { return _elementCount; }
 
+	int capacity() const { return _allocatedCount & ~INLINE_STORAGE; }
+	/*
+	 *	clear
+	 *
+	 *	Destroys the elements and releases any heap block.  Inline
+	 *	storage handed over by a smallVector is kept.
+	 */
 	void clear() {
-		delete [] (A*)_elements;
-		_elements = null;
+		if (_elements) {
+			destroy(0, _elementCount);
+			if (!usingInlineStorage()) {
+				free(_elements);
+				_elements = null;
+				_allocatedCount = 0;
+			}
+		}
 		_elementCount = 0;
-		_allocatedCount = 0;
 	}
 
 	void deleteAll() {
@@ -50,43 +137,123 @@ public:
 	}
 
 	void resize(int length) {
-		int new_size;
-		if (_elements) {
-			if (_allocatedCount >= length) {
-				if (length == 0)
-					clear();
-				else
-					_elementCount = length;
-				return;
-			}
-			new_size = reserved_size(length);
-			if (_allocatedCount == new_size) {
+		if (length <= _elementCount) {
+			if (length <= 0)
+				clear();
+			else {
+				destroy(length, _elementCount);
 				_elementCount = length;
-				return;
 			}
-		} else {
-			if (length == 0)
-				return;
-			new_size = reserved_size(length);
-		}
-		A* a = new A[new_size];
-		if (_elements) {
-			for (int i = 0; i < _elementCount; i++)
-				a[i] = _elements->data[i];
-			delete [] (A*)_elements;
+			return;
 		}
-		_allocatedCount = new_size;
-		_elements = (SA*)a;
+		if (length > capacity())
+			reallocate(reserved_size(length));
+		for (int i = _elementCount; i < length; i++)
+			new (&_elements->data[i]) A;
 		_elementCount = length;
 	}
+	/*
+	 *	reserve
+	 *
+	 *	Makes sure there is room for at least 'length' elements
+	 *	without any further allocation.  The size of the vector
+	 *	is not changed.
+	 */
+	void reserve(int length) {
+		if (length > capacity())
+			reallocate(reserved_size(length));
+	}
+	/*
+	 *	shrink_to_fit
+	 *
+	 *	Releases any unused capacity beyond the current size.
+	 */
+	void shrink_to_fit() {
+		if (usingInlineStorage())
+			return;
+		if (_elementCount == 0)
+			clear();
+		else if (_elementCount < capacity())
+			reallocate(_elementCount);
+	}
+
+	void push_back(const A& a) {
+		if (_elementCount < capacity())
+			new (&_elements->data[_elementCount]) A(a);
+		else {
+			// 'a' may be an element of this vector, so copy it
+			// before the storage moves.
+			A copy(a);
+			reallocate(reserved_size(_elementCount + 1));
+			new (&_elements->data[_elementCount]) A(static_cast<A&&>(copy));
+		}
+		_elementCount++;
+	}
 
-	void push_back(A a) {
-		resize(_elementCount + 1);
-		_elements->data[_elementCount - 1] = a;
+	void push_back(A&& a) {
+		if (_elementCount >= capacity()) {
+			A moved(static_cast<A&&>(a));
+			reallocate(reserved_size(_elementCount + 1));
+			new (&_elements->data[_elementCount]) A(static_cast<A&&>(moved));
+		} else
+			new (&_elements->data[_elementCount]) A(static_cast<A&&>(a));
+		_elementCount++;
+	}
+	/*
+	 *	emplace_back
+	 *
+	 *	Constructs a new element in place at the end of the vector,
+	 *	passing the arguments to the element's constructor.
+	 *
+	 *	RETURNS:
+	 *		The newly constructed element.
+	 */
+	A& emplace_back() {
+		reserve(_elementCount + 1);
+		new (&_elements->data[_elementCount]) A();
+		return _elements->data[_elementCount++];
+	}
+
+	template<class M>
+	A& emplace_back(M&& m) {
+		if (_elementCount < capacity())
+			new (&_elements->data[_elementCount]) A(static_cast<M&&>(m));
+		else {
+			// The arguments may refer to elements of this vector, so
+			// build the new element before the storage moves.
+			A a(static_cast<M&&>(m));
+			reallocate(reserved_size(_elementCount + 1));
+			new (&_elements->data[_elementCount]) A(static_cast<A&&>(a));
+		}
+		return _elements->data[_elementCount++];
+	}
+
+	template<class M, class N>
+	A& emplace_back(M&& m, N&& n) {
+		if (_elementCount < capacity())
+			new (&_elements->data[_elementCount]) A(static_cast<M&&>(m), static_cast<N&&>(n));
+		else {
+			A a(static_cast<M&&>(m), static_cast<N&&>(n));
+			reallocate(reserved_size(_elementCount + 1));
+			new (&_elements->data[_elementCount]) A(static_cast<A&&>(a));
+		}
+		return _elements->data[_elementCount++];
+	}
+
+	template<class M, class N, class O>
+	A& emplace_back(M&& m, N&& n, O&& o) {
+		if (_elementCount < capacity())
+			new (&_elements->data[_elementCount]) A(static_cast<M&&>(m), static_cast<N&&>(n), static_cast<O&&>(o));
+		else {
+			A a(static_cast<M&&>(m), static_cast<N&&>(n), static_cast<O&&>(o));
+			reallocate(reserved_size(_elementCount + 1));
+			new (&_elements->data[_elementCount]) A(static_cast<A&&>(a));
+		}
+		return _elements->data[_elementCount++];
 	}
 
 	A pop_back() {
-		A a = _elements->data[_elementCount - 1];
+		A a(static_cast<A&&>(_elements->data[_elementCount - 1]));
 		resize(_elementCount - 1);
 		return a;
 	}
@@ -101,23 +268,34 @@ public:
 		if (i + count > _elementCount)
 			count = _elementCount - i;
 		for (int j = i + count; j < _elementCount; j++)
-			_elements->data[j - count] = _elements->data[j];
+			_elements->data[j - count] = static_cast<A&&>(_elements->data[j]);
 		resize(_elementCount - count);
 	}
 
 	void insert(int i, A a) {
 		if (i < 0 || i > _elementCount)
 			return;
-		resize(_elementCount + 1);
-		for (int j = _elementCount - 1; j > i; j--)
-			_elements->data[j] = _elements->data[j - 1];
-		_elements->data[i] = a;
+		reserve(_elementCount + 1);
+		if (i == _elementCount)
+			new (&_elements->data[i]) A(static_cast<A&&>(a));
+		else {
+			new (&_elements->data[_elementCount]) A(static_cast<A&&>(_elements->data[_elementCount - 1]));
+			for (int j = _elementCount - 1; j > i; j--)
+				_elements->data[j] = static_cast<A&&>(_elements->data[j - 1]);
+			_elements->data[i] = static_cast<A&&>(a);
+		}
+		_elementCount++;
 	}
 
 	void sort(bool ascending = true) {
 		::sort(this, 0, _elementCount, ascending);
 	}
 
+	template<class Compare>
+	void sort(Compare compare) {
+		::sort(this, compare);
+	}
+
 	bool contains(A x) const {
 		for (int i = 0; i < _elementCount; i++) {
 			if (x == _elements->data[i])
@@ -157,8 +335,38 @@ public:
 		return _elements->data[i];
 	}
 
+protected:
+	struct SA {
+		A		data[5];
+	};
+	/*
+	 *	This constructor is used by smallVector to hand over a buffer
+	 *	inside the derived object.  It is used until the vector grows
+	 *	past 'inlineCount' elements.
+	 */
+	vector(void* inlineBuffer, int inlineCount) {
+		_elements = null;
+		_elementCount = 0;
+		_allocatedCount = 0;
+		useInlineStorage(inlineBuffer, inlineCount);
+	}
+	/*
+	 *	useInlineStorage
+	 *
+	 *	Points a vector that has no storage at 'inlineBuffer', which
+	 *	holds 'inlineCount' elements and is never freed by the vector.
+	 */
+	void useInlineStorage(void* inlineBuffer, int inlineCount) {
+		_elements = (SA*)inlineBuffer;
+		_allocatedCount = inlineCount | INLINE_STORAGE;
+	}
+
 private:
-	static const int MIN_SIZE = 0x10;
+	static const int INLINE_STORAGE = 0x40000000;	// flag in _allocatedCount: _elements is a smallVector's buffer
+
+	bool usingInlineStorage() const {
+		return (_allocatedCount & INLINE_STORAGE) != 0;
+	}
 
 	int reserved_size(int length) {
 		int used_size = length;
@@ -167,20 +375,183 @@ private:
 			alloc_size <<= 1;
 		return alloc_size;
 	}
+	/*
+	 *	reallocate
+	 *
+	 *	Moves the live elements into a heap block of exactly 'new_size'
+	 *	elements.  Relocatable elements ride along with realloc (or a
+	 *	memcpy out of inline storage), everything else is move-constructed
+	 *	into the new block and the old copies destroyed.
+	 */
+	void reallocate(int new_size) {
+		SA* a;
+		bool inlineStorage = usingInlineStorage();
+		if (isRelocatable<A>::value && !inlineStorage)
+			a = (SA*)realloc((void*)_elements, new_size * sizeof (A));
+		else {
+			a = (SA*)malloc(new_size * sizeof (A));
+			if (_elements) {
+				if (isRelocatable<A>::value) {
+					if (_elementCount > 0)
+						memcpy((void*)a, (const void*)_elements, _elementCount * sizeof (A));
+				} else {
+					for (int i = 0; i < _elementCount; i++) {
+						new (&a->data[i]) A(static_cast<A&&>(_elements->data[i]));
+						_elements->data[i].~A();
+					}
+				}
+				if (!inlineStorage)
+					free(_elements);
+			}
+		}
+		_elements = a;
+		_allocatedCount = new_size;
+	}
 
-	struct SA {
-		A		data[5];
-	};
+	void copyFrom(const vector<A, MIN_SIZE>& source) {
+		if (source._elementCount == 0)
+			return;
+		reserve(source._elementCount);
+		for (int i = 0; i < source._elementCount; i++)
+			new (&_elements->data[i]) A(source._elements->data[i]);
+		_elementCount = source._elementCount;
+	}
+	/*
+	 *	takeFrom
+	 *
+	 *	Moves the contents of an empty 'this' out of 'source'.  A heap
+	 *	block simply changes hands, inline elements have to be moved
+	 *	one at a time.
+	 */
+	void takeFrom(vector<A, MIN_SIZE>& source) {
+		if (source.usingInlineStorage()) {
+			if (source._elementCount == 0)
+				return;
+			reserve(source._elementCount);
+			for (int i = 0; i < source._elementCount; i++)
+				new (&_elements->data[i]) A(static_cast<A&&>(source._elements->data[i]));
+			_elementCount = source._elementCount;
+			source.clear();
+		} else {
+			if (_elements && !usingInlineStorage())
+				free(_elements);
+			_elements = source._elements;
+			_elementCount = source._elementCount;
+			_allocatedCount = source._allocatedCount;
+			source._elements = null;
+			source._elementCount = 0;
+			source._allocatedCount = 0;
+		}
+	}
 
+	void destroy(int from, int to) {
+		for (int i = from; i < to; i++)
+			_elements->data[i].~A();
+	}
 	SA*			_elements;
 	int			_elementCount;
-	int			_allocatedCount;
+	int			_allocatedCount;	// may have INLINE_STORAGE set (see capacity)
+};
+
+#pragma pop_macro("new")
+
+template<class A, int M>
+struct isRelocatable<vector<A, M> > {
+	static const bool value = true;
+};
+/*
+ *	smallVector
+ *
+ *	A vector that holds up to N elements inside the object, so that
+ *	short lists cost no heap allocation at all.  Once it grows past N
+ *	elements it moves to the heap like any other vector.  A smallVector
+ *	can be passed wherever a vector<A> is expected.
+ *
+ *	Clearing a smallVector (with clear or resize(0) called on the
+ *	smallVector itself) releases any heap block and returns it to the
+ *	inline buffer, so a smallVector used as a scratch list only
+ *	allocates while it holds more than N elements.  Through a vector<A>&
+ *	it clears like a vector, and next grows on the heap.
+ *
+ *	Unlike vector, a smallVector is not relocatable, so it must not
+ *	itself be stored in a vector.
+ */
+template<class A, int N>
+class smallVector : public vector<A> {
+public:
+	smallVector() : vector<A>(&_buffer, N) {
+	}
+
+	smallVector(const vector<A>& source) : vector<A>(&_buffer, N) {
+		vector<A>::operator= (source);
+	}
+
+	smallVector(const smallVector<A, N>& source) : vector<A>(&_buffer, N) {
+		vector<A>::operator= (source);
+	}
+
+	smallVector(vector<A>&& source) : vector<A>(&_buffer, N) {
+		vector<A>::operator= (static_cast<vector<A>&&>(source));
+	}
+
+	smallVector(smallVector<A, N>&& source) : vector<A>(&_buffer, N) {
+		vector<A>::operator= (static_cast<vector<A>&&>(source));
+	}
+
+	~smallVector() {
+		vector<A>::clear();
+	}
+
+	smallVector<A, N>& operator= (const vector<A>& source) {
+		if (this != &source) {
+			clear();
+			vector<A>::operator= (source);
+		}
+		return *this;
+	}
+
+	smallVector<A, N>& operator= (const smallVector<A, N>& source) {
+		return operator= (static_cast<const vector<A>&>(source));
+	}
+
+	smallVector<A, N>& operator= (vector<A>&& source) {
+		if (this != &source) {
+			clear();
+			vector<A>::operator= (static_cast<vector<A>&&>(source));
+		}
+		return *this;
+	}
+
+	smallVector<A, N>& operator= (smallVector<A, N>&& source) {
+		return operator= (static_cast<vector<A>&&>(source));
+	}
+
+	void clear() {
+		vector<A>::clear();
+		if (this->capacity() == 0)
+			this->useInlineStorage(&_buffer, N);
+	}
+
+	void resize(int length) {
+		if (length <= 0)
+			clear();
+		else
+			vector<A>::resize(length);
+	}
+
+private:
+	union {
+		char		bytes[N * sizeof (A)];
+		double		alignDouble;
+		void*		alignPointer;
+		long long	alignLong;
+	}			_buffer;
 };
 
-template<class A, class Key>
-int binarySearch(const vector<A>& a, const Key& key) {
+template<class A, int M, class Key>
+int binarySearch(const vector<A, M>& a, const Key& key) {
 	int min = 0;
-	int max = a.size();
+	int max = a.size() - 1;
 
 	while (min <= max) {
 		int mid = (max + min) / 2;
@@ -208,8 +579,8 @@ int binarySearch(const vector<A>& a, const Key& key) {
  *		N < size	If element N is the smallest greater than the key.
  *		size		If no element is greater than the key.
  */
-template<class A, class Key>
-int binarySearchClosestGreater(const vector<A>& a, const Key& key) {
+template<class A, int M, class Key>
+int binarySearchClosestGreater(const vector<A, M>& a, const Key& key) {
 	int min = 0;
 	int max = a.size() - 1;
 	int mid = -1;
@@ -230,28 +601,264 @@ int binarySearchClosestGreater(const vector<A>& a, const Key& key) {
 	return mid;
 }
 
+/*
+ *	Sorting
+ *
+ *	All of the sort functions below take a comparison that, like the
+ *	compare methods used throughout this library, returns < 0 if its
+ *	first argument orders before its second, > 0 if after and 0 if
+ *	they are equal.  A comparison is any object or function that can be
+ *	called as compare(x, y).
+ *
+ *	The sort is an introsort: a median-of-three quicksort that switches
+ *	to heapsort if the recursion gets too deep and finishes small
+ *	partitions with an insertion sort.  It takes O(n log n) time in the
+ *	worst case (including already sorted input) and O(log n) stack.
+ *	It is not stable.
+ */
 template<class A>
-void sort(vector<A*>* a, int min, int max, bool ascending) {
-	if (min >= max)
-		return;
-	A* pivot = (*a)[min];
-	int greaterFillPoint = max;
-	int i = min + 1;
-	while (i < greaterFillPoint) {
-		int relation = pivot->compare((*a)[i]);
-		if (!ascending)
-			relation = -relation;
-		if (relation < 0) {
-			greaterFillPoint--;
-			A* high = (*a)[greaterFillPoint];
-			(*a)[greaterFillPoint] = (*a)[i];
-			(*a)[i] = high;
-		} else {
-			(*a)[i - 1] = (*a)[i];
+class PointerOrder {
+public:
+	PointerOrder(bool ascending) {
+		_ascending = ascending;
+	}
+
+	int operator () (A* x, A* y) const {
+		int relation = x->compare(y);
+		return _ascending ? relation : -relation;
+	}
+
+private:
+	bool		_ascending;
+};
+
+template<class A>
+class ValueOrder {
+public:
+	ValueOrder(bool ascending) {
+		_ascending = ascending;
+	}
+
+	int operator () (const A& x, const A& y) const {
+		int relation = x.compare(y);
+		return _ascending ? relation : -relation;
+	}
+
+private:
+	bool		_ascending;
+};
+
+static const int INSERTION_SORT_THRESHOLD = 16;
+
+template<class A>
+inline void swapElements(A& x, A& y) {
+	A t(static_cast<A&&>(x));
+	x = static_cast<A&&>(y);
+	y = static_cast<A&&>(t);
+}
+
+template<class A, class Compare>
+void insertionSort(A* a, int min, int max, Compare& compare) {
+	for (int i = min + 1; i < max; i++) {
+		if (compare(a[i], a[i - 1]) >= 0)
+			continue;
+		A x(static_cast<A&&>(a[i]));
+		int j = i;
+		do {
+			a[j] = static_cast<A&&>(a[j - 1]);
+			j--;
+		} while (j > min && compare(x, a[j - 1]) < 0);
+		a[j] = static_cast<A&&>(x);
+	}
+}
+
+template<class A, class Compare>
+void siftDown(A* a, int min, int root, int count, Compare& compare) {
+	A x(static_cast<A&&>(a[min + root]));
+	for (;;) {
+		int child = 2 * root + 1;
+		if (child >= count)
+			break;
+		if (child + 1 < count && compare(a[min + child], a[min + child + 1]) < 0)
+			child++;
+		if (compare(x, a[min + child]) >= 0)
+			break;
+		a[min + root] = static_cast<A&&>(a[min + child]);
+		root = child;
+	}
+	a[min + root] = static_cast<A&&>(x);
+}
+
+template<class A, class Compare>
+void heapSort(A* a, int min, int max, Compare& compare) {
+	int count = max - min;
+	for (int i = count / 2 - 1; i >= 0; i--)
+		siftDown(a, min, i, count, compare);
+	for (int i = count - 1; i > 0; i--) {
+		swapElements(a[min], a[min + i]);
+		siftDown(a, min, 0, i, compare);
+	}
+}
+/*
+ *	introsortLoop
+ *
+ *	Partitions [min, max) until every partition is no longer than
+ *	INSERTION_SORT_THRESHOLD.  Only the smaller side of each partition
+ *	is sorted recursively, the larger side is handled by the loop.
+ */
+template<class A, class Compare>
+void introsortLoop(A* a, int min, int max, int depthLimit, Compare& compare) {
+	while (max - min > INSERTION_SORT_THRESHOLD) {
+		if (depthLimit == 0) {
+			heapSort(a, min, max, compare);
+			return;
+		}
+		depthLimit--;
+
+			// Order a[min], a[mid] and a[max - 1], then move the median
+			// to a[min] as the pivot.  a[max - 1] is then no less than
+			// the pivot, which bounds the upward scan.
+
+		int mid = min + (max - min) / 2;
+		if (compare(a[mid], a[min]) < 0)
+			swapElements(a[mid], a[min]);
+		if (compare(a[max - 1], a[mid]) < 0) {
+			swapElements(a[max - 1], a[mid]);
+			if (compare(a[mid], a[min]) < 0)
+				swapElements(a[mid], a[min]);
+		}
+		swapElements(a[min], a[mid]);
+
+		int i = min + 1;
+		int j = max - 1;
+		for (;;) {
+			while (compare(a[i], a[min]) < 0)
+				i++;
+			while (compare(a[min], a[j]) < 0)
+				j--;
+			if (i >= j)
+				break;
+			swapElements(a[i], a[j]);
 			i++;
+			j--;
+		}
+		swapElements(a[min], a[j]);
+
+		if (j - min < max - j - 1) {
+			introsortLoop(a, min, j, depthLimit, compare);
+			min = j + 1;
+		} else {
+			introsortLoop(a, j + 1, max, depthLimit, compare);
+			max = j;
+		}
+	}
+}
+
+template<class A, class Compare>
+void introsort(A* a, int min, int max, Compare& compare) {
+	if (max - min < 2)
+		return;
+	int depthLimit = 0;
+	for (int n = max - min; n > 1; n >>= 1)
+		depthLimit += 2;
+	introsortLoop(a, min, max, depthLimit, compare);
+	insertionSort(a, min, max, compare);
+}
+/*
+ *	mergeRuns
+ *
+ *	Merges the sorted runs [min, mid) and [mid, max) in place, using
+ *	'scratch' to hold the first run.  Where elements compare equal,
+ *	those from the first run come first.
+ */
+template<class A, class Compare>
+void mergeRuns(A* a, int min, int mid, int max, A* scratch, Compare& compare) {
+	if (min == mid || mid == max || compare(a[mid], a[mid - 1]) >= 0)
+		return;
+	int n = mid - min;
+	for (int i = 0; i < n; i++)
+		scratch[i] = static_cast<A&&>(a[min + i]);
+	int i = 0;
+	int j = mid;
+	int k = min;
+	while (i < n && j < max) {
+		if (compare(a[j], scratch[i]) < 0)
+			a[k++] = static_cast<A&&>(a[j++]);
+		else
+			a[k++] = static_cast<A&&>(scratch[i++]);
+	}
+	while (i < n)
+		a[k++] = static_cast<A&&>(scratch[i++]);
+}
+/*
+ *	mergeSort
+ *
+ *	A bottom-up merge sort of [min, max): runs of INSERTION_SORT_THRESHOLD
+ *	elements are insertion sorted, then merged pairwise.  'scratch' must
+ *	have room for max - min elements.  Runs that are already in order
+ *	are not copied, so sorted input costs one pass.
+ */
+template<class A, class Compare>
+void mergeSort(A* a, int min, int max, A* scratch, Compare& compare) {
+	for (int i = min; i < max; i += INSERTION_SORT_THRESHOLD) {
+		int end = i + INSERTION_SORT_THRESHOLD;
+		insertionSort(a, i, end < max ? end : max, compare);
+	}
+	for (int width = INSERTION_SORT_THRESHOLD; width < max - min; width *= 2) {
+		for (int i = min; i + width < max; i += 2 * width) {
+			int end = i + 2 * width;
+			mergeRuns(a, i, i + width, end < max ? end : max, scratch, compare);
 		}
 	}
-	(*a)[i - 1] = pivot;
-	sort(a, min, i - 1, ascending);
-	sort(a, i, max, ascending);
+}
+/*
+ *	sort
+ *
+ *	Sorts the elements [min, max) of a vector of pointers, using the
+ *	compare method of the pointed-to class.
+ */
+template<class A, int M>
+void sort(vector<A*, M>* a, int min, int max, bool ascending) {
+	if (min >= max)
+		return;
+	PointerOrder<A> order(ascending);
+	introsort(&(*a)[0], min, max, order);
+}
+/*
+ *	sort
+ *
+ *	Sorts the elements [min, max) of a vector of values, using the
+ *	compare method of the element class.
+ */
+template<class A, int M>
+void sort(vector<A, M>* a, int min, int max, bool ascending) {
+	if (min >= max)
+		return;
+	ValueOrder<A> order(ascending);
+	introsort(&(*a)[0], min, max, order);
+}
+/*
+ *	sort
+ *
+ *	Sorts a whole vector using the given comparison.
+ */
+template<class A, int M, class Compare>
+void sort(vector<A, M>* a, Compare compare) {
+	if (a->size() > 1)
+		introsort(&(*a)[0], 0, a->size(), compare);
+}
+/*
+ *	stableSort
+ *
+ *	Sorts a whole vector using the given comparison, keeping elements
+ *	that compare equal in their original order.  Takes O(n log n) time
+ *	and n elements of scratch space.
+ */
+template<class A, int M, class Compare>
+void stableSort(vector<A, M>* a, Compare compare) {
+	if (a->size() > 1) {
+		A* scratch = new A[a->size()];
+		mergeSort(&(*a)[0], 0, a->size(), scratch, compare);
+		delete [] scratch;
+	}
 }
@@ -1,9 +1,14 @@
 #include "../common/platform.h"
 #include "xml.h"
 
-#include <math.h>
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define XML_SSE2
+#endif
+#include <limits.h>
 #include "file_system.h"
 #include "machine.h"
+#include "map.h"
 
 namespace xml {
 
@@ -18,15 +23,87 @@ Document* load(const string& filename, bool exact) {
 }
 
 Document::Document() {
+	_idName = Symbol("id");
 	clear();
 }
 
 bool Document::load(const string& filename, bool exact) {
+	DOMParser p(this, null);
+	int length;
+	FILE* stream;
+	char* text = readFile(filename, &length, &stream);
+	if (text == null)
+		return loadStream(stream, exact);
+	p.parse(text, length, exact);
+	return !_parseError;
+}
+
+bool Document::loadLazily(const string& filename, bool exact) {
+	DOMParser p(this, null);
+	int length;
+	FILE* stream;
+	char* text = readFile(filename, &length, &stream);
+	if (text == null)
+		return loadStream(stream, exact);
+	if (buildTape(text, length, exact))
+		return true;
+	_tape.clear();
+	_tapeIds.clear();
+	p.parse(text, length, exact);
+	return !_parseError;
+}
+/*
+ *	readFile
+ *
+ *	If the size of the file cannot be told, or it will not fit in an
+ *	int with a null after it, nothing is read and *stream is left
+ *	holding the open file, at its start, to be parsed as a stream.
+ *	Otherwise *stream is null.
+ *
+ *	RETURNS:
+ *		The text of the file, null terminated, in the arena, or null if
+ *		the file could not be opened or read, or must be streamed.
+ */
+char* Document::readFile(const string& filename, int* length, FILE** stream) {
+	*stream = null;
 	FILE* fp = fileSystem::openTextFile(filename);
 	if (fp == null)
-		return false;
-	load(fp, exact);
+		return null;
+	long size = -1;
+	if (fseek(fp, 0, SEEK_END) == 0) {
+		size = ftell(fp);
+		if (fseek(fp, 0, SEEK_SET) != 0) {
+			fclose(fp);
+			return null;
+		}
+	}
+	if (size < 0 || size > INT_MAX - 1) {
+		*stream = fp;
+		return null;
+	}
+	char* text = (char*)_arena.allocate(size + 1);
+	int n = fread(text, 1, size, fp);
+	bool failed = ferror(fp) != 0;
 	fclose(fp);
+	if (failed)
+		return null;
+	text[n] = 0;
+	*length = n;
+	return text;
+}
+/*
+ *	loadStream
+ *
+ *	Parses and closes a file that readFile handed back unread.
+ *
+ *	RETURNS:
+ *		false if there is no such file or it did not parse cleanly.
+ */
+bool Document::loadStream(FILE* stream, bool exact) {
+	if (stream == null)
+		return false;
+	load(stream, exact);
+	fclose(stream);
 	return !_parseError;
 }
 
@@ -38,10 +115,146 @@ void Document::load(FILE* stream, bool exact) {
 void Document::clear() {
 	_parseError = false;
 	_root = null;
+	_tape.clear();
+	_source = null;
+	_sourceLength = 0;
+	_ids.clear();
+	_tapeIds.clear();
+	_duplicateIds = false;
+	_arena.release();
+}
+
+Element* Document::newElement(Symbol tag, script::fileOffset_t location, ElementKind kind) {
+	Element* e = new (_arena.allocate(sizeof (Element))) Element(tag, location, kind);
+	e->_document = this;
+	return e;
+}
+
+Element* Document::newElement(const stringSlice& text, script::fileOffset_t location, ElementKind kind) {
+	Element* e = new (_arena.allocate(sizeof (Element))) Element(text, location, kind);
+	e->_document = this;
+	return e;
+}
+
+Attribute* Document::newAttribute(Symbol name, const stringSlice& value, script::fileOffset_t location) {
+	return new (_arena.allocate(sizeof (Attribute))) Attribute(name, value, location);
+}
+
+stringSlice Document::copy(const stringSlice& text) {
+	return stringSlice(_arena.copy(text.text(), text.size()), text.size());
+}
+
+void Document::setValue(Element* e, Symbol name, const string* value, script::fileOffset_t location) {
+	if (value)
+		e->setValue(newAttribute(name, copy(*value), location));
+	else
+		e->removeValue(name);
+}
+
+void Document::set_root(Element* e) {
+	_root = e;
+	_ids.clear();
+	_duplicateIds = false;
+	if (e != null)
+		indexTree(e);
 }
 
 Element* Document::getValue(const string &id) {
-	return _root->getById(id);
+	Element** e = _ids.find(id);
+	if (e != null)
+		return *e;
+
+		// Elements not yet made from the tape are not indexed
+
+	if (_tape.size())
+		return findOnTape(id);
+	return null;
+}
+/*
+ *	contains
+ *
+ *	RETURNS:
+ *		true if 'e' is in the tree: under the root, or under one of the
+ *		elements a malformed document has after it.
+ */
+bool Document::contains(Element* e) {
+	while (e->parent != null)
+		e = e->parent;
+	for (Element* r = _root; r != null; r = r->sibling)
+		if (r == e)
+			return true;
+	return false;
+}
+
+void Document::indexId(Element* e) {
+	stringSlice* id = e->getValue(_idName);
+	if (id != null &&
+		!_ids.insert(id->text(), id->size(), e) &&
+		*_ids.get(id->text(), id->size()) != e)
+		_duplicateIds = true;
+}
+/*
+ *	indexTree
+ *
+ *	Indexes 'e' and the descendants that have been made.  The rest are
+ *	found on the tape.
+ */
+void Document::indexTree(Element* e) {
+	indexId(e);
+	for (Element* c = e->child; c != null; c = c->sibling)
+		indexTree(c);
+}
+
+void Document::unindexTree(Element* e) {
+	stringSlice* id = e->getValue(_idName);
+	if (id != null)
+		unindex(e, *id);
+	for (Element* c = e->child; c != null; c = c->sibling)
+		unindexTree(c);
+}
+
+static Element* findMade(Element* e, Symbol idName, const string& id) {
+	for (; e != null; e = e->sibling) {
+		stringSlice* m = e->getValue(idName);
+		if (m != null && *m == id)
+			return e;
+		Element* x = findMade(e->child, idName, id);
+		if (x != null)
+			return x;
+	}
+	return null;
+}
+/*
+ *	unindex
+ *
+ *	Drops the index entry for 'id' if it refers to 'e'.  When ids have
+ *	been duplicated, another element with the same id may be in the
+ *	tree, so the tree is searched for it; otherwise the entry is simply
+ *	gone.
+ */
+void Document::unindex(Element* e, const stringSlice& id) {
+	if (*_ids.get(id.text(), id.size()) != e)
+		return;
+	string key = id.toString();
+	_ids.remove(key);
+	if (_duplicateIds) {
+		Element* other = findMade(_root, _idName, key);
+		if (other != null)
+			_ids.insert(key, other);
+	}
+}
+/*
+ *	idChanged
+ *
+ *	Called when attribute 'name' of 'e' has been set or removed, with
+ *	the value it had before, if any.
+ */
+void Document::idChanged(Element* e, Symbol name, const stringSlice* oldValue) {
+	if (name != _idName || !contains(e))
+		return;
+	if (oldValue != null)
+		unindex(e, *oldValue);
+	indexId(e);
 }
 /*
 	save: (filename: string) boolean
@@ -163,75 +376,108 @@ Element* Document::getValue(const string &id) {
 	}
 }
 */
-Element::Element(const string &tag, script::fileOffset_t i) {
+Element::Element(Symbol tag, script::fileOffset_t i, ElementKind kind) {
 	this->tag = tag;
 	this->location = i;
-	this->kind = ELEMENT;
+	this->kind = kind;
 	init();
 }
 
-Element::Element(const string &tag, script::fileOffset_t i, ElementKind kind) {
-	this->tag = tag;
+Element::Element(const stringSlice& text, script::fileOffset_t i, ElementKind kind) {
+	this->text = text;
 	this->location = i;
 	this->kind = kind;
 	init();
 }
 
+Element* Element::firstChild() {
+	if (_tape >= 0)
+		_document->expand(this);
+	return child;
+}
+
 void Element::init() {
 	parent = null;
 	child = null;
 	sibling = null;
 	attributes = null;
+	_document = null;
+	_tape = -1;
 }
 
 Element* Element::getById(const string &id) {
-	string* m = getValue("id");
+	if (_document != null && _document->root() == this)
+		return _document->getValue(id);
+	Symbol idName;
+	if (!Symbol::find("id", 2, &idName))
+		return null;
+	return findById(idName, id);
+}
+
+Element* Element::findById(Symbol idName, const string &id) {
+	stringSlice* m = getValue(idName);
 	if (m != null && *m == id)
 		return this;
-	if (child != null){
-		Element* e = child->getById(id);
+	if (firstChild() != null){
+		Element* e = child->findById(idName, id);
 		if (e != null)
 			return e;
 	}
 	if (sibling != null){
-		Element* e = sibling->getById(id);
+		Element* e = sibling->findById(idName, id);
 		if (e != null)
 			return e;
 	}
 	return null;
 }
 
-string* Element::getValue(const string& name) {
+stringSlice* Element::getValue(const string& name) {
+	Symbol s;
+	if (!Symbol::find(name, &s))
+		return null;
+	return getValue(s);
+}
+
+stringSlice* Element::getValue(Symbol name) {
 	for (Attribute* a = attributes; a != null; a = a->next)
-		if (strcmp(a->name.c_str(), name.c_str()) == 0)
+		if (a->name == name)
 			return &a->value;
 	return null;
 }
 
-void Element::setValue(const string& name, const string* value, script::fileOffset_t location) {
-	if (attributes == null){
-		if (value)
-			attributes = new Attribute(name, *value, location);
-		return;
-	}
+void Element::setValue(Attribute* a) {
 	Attribute* aprev = null;
-	for (Attribute* a = attributes; ; aprev = a, a = a->next){
-		if (strcmp(a->name.c_str(), name.c_str()) == 0){
-			if (value){
-				a->value = *value;
-				a->location = location;
-			} else {
-				if (aprev == null)
-					attributes = a->next;
-				else
-					aprev->next = a->next;
-				delete a;
-			}
+	for (Attribute* x = attributes; x != null; aprev = x, x = x->next){
+		if (x->name == a->name){
+			a->next = x->next;
+			if (aprev == null)
+				attributes = a;
+			else
+				aprev->next = a;
+			if (_document != null)
+				_document->idChanged(this, a->name, &x->value);
 			return;
 		}
-		if (a->next == null){
-			if (value)
-				a->next = new Attribute(name, *value, location);
+	}
+	a->next = null;
+	if (aprev == null)
+		attributes = a;
+	else
+		aprev->next = a;
+	if (_document != null)
+		_document->idChanged(this, a->name, null);
+}
+
+void Element::removeValue(Symbol name) {
+	Attribute* aprev = null;
+	for (Attribute* a = attributes; a != null; aprev = a, a = a->next){
+		if (a->name == name){
+			if (aprev == null)
+				attributes = a->next;
+			else
+				aprev->next = a->next;
+			if (_document != null)
+				_document->idChanged(this, name, &a->value);
 			return;
 		}
 	}
@@ -253,7 +499,7 @@ void Element::setValue(const string& name, const string* value, script::fileOffs
 	}
 */
 void Element::append(Element* e) {
-	if (child == null)
+	if (firstChild() == null)
 		child = e;
 	else {
 		Element* c;
@@ -263,6 +509,8 @@ void Element::append(Element* e) {
 	}
 	e->sibling = null;
 	e->parent = this;
+	if (_document != null && _document->contains(this))
+		_document->indexTree(e);
 }
 /*
 	insertAfter: (e: Element)
@@ -310,6 +558,9 @@ void Element::extract() {
 		// Only do anything if this Element has a parent
 
 	if (parent != null) {
+		Document* d = parent->_document;
+		if (d != null && !d->contains(parent))
+			d = null;
 		Element* pc = null;
 		for (Element* c = parent->child; c != null; c = c->sibling) {
 			if (c == this) {
@@ -319,6 +570,8 @@ void Element::extract() {
 					parent->child = sibling;
 				parent = null;
 				sibling = null;
+				if (d != null)
+					d->unindexTree(this);
 				return;
 			}
 			pc = c;
@@ -387,6 +640,9 @@ void Element::extract() {
 */
 DOMParser::DOMParser(Document* doc, script::MessageLog* messageLog) : Parser(messageLog) {
 	xmlDoc = doc;
+	inPlace = false;
+	last = null;
+	context = null;
 	doc->clear();
 }
 /*
@@ -402,11 +658,17 @@ DOMParser::DOMParser(Document* doc, script::MessageLog* messageLog) : Parser(mes
 */
 Document* DOMParser::parse(FILE* stream, bool e) {
 	exact = e;
-	string text;
-	if (!fileSystem::readAll(stream, &text))
-		return false;
-	open(text);
-	parse();
+	inPlace = false;
+	super::parse(stream);
+	close();
+	return result();
+}
+
+Document* DOMParser::parse(char* text, int length, bool e) {
+	exact = e;
+	inPlace = true;
+	open(text, length);
+	super::parse();
 	close();
 	return result();
 }
@@ -422,9 +684,10 @@ void DOMParser::append(Element* e) {
 		if (context == null){
 			xmlDoc->_parseError = true;
 			last = xmlDoc->root();
-			xmlDoc->set_root(new Element(null, script::FILE_OFFSET_ZERO, ROOT));
-			xmlDoc->root()->child = last;
-			last->parent = xmlDoc->root();
+			Element* root = xmlDoc->newElement(Symbol(), script::FILE_OFFSET_ZERO, ROOT);
+			root->child = last;
+			last->parent = root;
+			xmlDoc->set_root(root);
 //			fire xmlDoc.newChild(xmlDoc.root)
 			last->sibling = e;
 			e->parent = xmlDoc->root();
@@ -457,7 +720,7 @@ bool DOMParser::pop() {
 
 Document* DOMParser::result() {
 	if (xmlDoc->root() == null){
-		xmlDoc->set_root(new Element("", script::FILE_OFFSET_ZERO, TEXT));
+		xmlDoc->set_root(xmlDoc->newElement(stringSlice(), script::FILE_OFFSET_ZERO, TEXT));
 		xmlDoc->_parseError = false;
 	} else {
 		while (last != xmlDoc->root()){
@@ -469,7 +732,7 @@ Document* DOMParser::result() {
 				xmlDoc->root()->kind != TEXT)
 				break;
 			xmlDoc->_parseError = true;
-			Element* e = new Element(null, script::FILE_OFFSET_ZERO, ERROR_TEXT);
+			Element* e = xmlDoc->newElement(stringSlice(), script::FILE_OFFSET_ZERO, ERROR_TEXT);
 			append(e);
 			if (!pop())
 				break;
@@ -499,29 +762,29 @@ void DOMParser::inlineText(const saxString& txt, script::fileOffset_t location)
 			errorText(XEC_EXTRA_TEXT, txt, location);
 		return;
 	}
-	Element* e = new Element(string(txt.text, txt.length), location, TEXT);
+	Element* e = xmlDoc->newElement(keep(txt), location, TEXT);
 	append(e);
 }
 
 void DOMParser::errorText(ErrorCodes code, const saxString& txt, script::fileOffset_t location) {
-	Element* e = new Element(string("") + int(code) + ": " + string(txt.text, txt.length), location, ERROR_TEXT);
+	string message = string("") + int(code) + ": " + string(txt.text, txt.length);
+	Element* e = xmlDoc->newElement(xmlDoc->copy(message), location, ERROR_TEXT);
 	append(e);
 }
 
 void DOMParser::commentText(const saxString& txt, script::fileOffset_t location) {
 	if (exact){
-		Element* e = new Element(string(txt.text, txt.length), location, COMMENT);
+		Element* e = xmlDoc->newElement(keep(txt), location, COMMENT);
 		append(e);
 	}
 }
 
 bool DOMParser::anyTag(const saxString& tag) {
-	Element* e = new Element(string(tag.text, tag.length), tagLocation);
-	for (XMLParserAttributeList* a = unknownAttributes; a != null; a = a->next) {
-		string value = a->value.toString();
-		e->setValue(a->name.toString(), &value, a->location);
-	}
+	Element* e = xmlDoc->newElement(Symbol(tag.text, tag.length), tagLocation);
+	for (XMLParserAttributeList* a = unknownAttributes; a != null; a = a->next)
+		e->setValue(xmlDoc->newAttribute(Symbol(a->name.text, a->name.length), keep(a->value), a->location));
 	append(e);
+	xmlDoc->indexId(e);
 	push();
 	parseContents();
 	return true;
@@ -530,6 +793,580 @@ bool DOMParser::anyTag(const saxString& tag) {
 void DOMParser::anyCloseTag() {
 	pop();
 }
+/*
+ *	keep
+ *
+ *	RETURNS:
+ *		A slice holding the text of 's' for the life of the document:
+ *		's' itself when parsing in place, otherwise a copy.
+ */
+stringSlice DOMParser::keep(const saxString& s) {
+	if (inPlace)
+		return s.slice();
+	else
+		return xmlDoc->copy(s.slice());
+}
+
+static int popCount(unsigned x) {
+#if defined(__GNUC__)
+	return __builtin_popcount(x);
+#else
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	x = (x + (x >> 4)) & 0x0f0f0f0f;
+	return (x * 0x01010101) >> 24;
+#endif
+}
+
+static const int MAX_STOPS = 8;
+/*
+ *	scan
+ *
+ *	The tokenizer's inner loop.  Looks for the first byte of 'text' that
+ *	is one of the 'count' bytes in 'stops', sixteen bytes at a time when
+ *	SSE2 is available.  Newlines passed over are added to *lines, counted
+ *	a block at a time by popcount of the newline mask.
+ *
+ *	RETURNS:
+ *		The number of bytes before the first stop byte, or 'length' if
+ *		there is none.
+ */
+static int scan(const char* text, int length, const char* stops, int count, int* lines) {
+	int i = 0;
+#ifdef XML_SSE2
+	__m128i stop[MAX_STOPS];
+	for (int j = 0; j < count; j++)
+		stop[j] = _mm_set1_epi8(stops[j]);
+	__m128i newline = _mm_set1_epi8('\n');
+	for (; i + 16 <= length; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(text + i));
+		__m128i found = _mm_cmpeq_epi8(x, stop[0]);
+		for (int j = 1; j < count; j++)
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(x, stop[j]));
+		unsigned mask = _mm_movemask_epi8(found);
+		unsigned newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(x, newline));
+		if (mask) {
+			int n = hashTable::lowestBit(mask);
+			*lines += popCount(newlines & ((1u << n) - 1));
+			return i + n;
+		}
+		*lines += popCount(newlines);
+	}
+#endif
+	for (; i < length; i++) {
+		for (int j = 0; j < count; j++)
+			if (text[i] == stops[j])
+				return i;
+		if (text[i] == '\n')
+			(*lines)++;
+	}
+	return length;
+}
+/*
+ *	scanSpace
+ *
+ *	Like scan, but stops at the first byte that is not white space.
+ */
+static int scanSpace(const char* text, int length, int* lines) {
+	int i = 0;
+#ifdef XML_SSE2
+	__m128i space = _mm_set1_epi8(' ');
+	__m128i tab = _mm_set1_epi8('\t');
+	__m128i cr = _mm_set1_epi8('\r');
+	__m128i ff = _mm_set1_epi8('\f');
+	__m128i newline = _mm_set1_epi8('\n');
+	for (; i + 16 <= length; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(text + i));
+		__m128i nl = _mm_cmpeq_epi8(x, newline);
+		__m128i white = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, tab)),
+									 _mm_or_si128(_mm_cmpeq_epi8(x, cr), _mm_cmpeq_epi8(x, ff)));
+		white = _mm_or_si128(white, nl);
+		unsigned mask = ~_mm_movemask_epi8(white) & 0xffff;
+		unsigned newlines = _mm_movemask_epi8(nl);
+		if (mask) {
+			int n = hashTable::lowestBit(mask);
+			*lines += popCount(newlines & ((1u << n) - 1));
+			return i + n;
+		}
+		*lines += popCount(newlines);
+	}
+#endif
+	for (; i < length; i++) {
+		switch (text[i]) {
+		case	' ':
+		case	'\t':
+		case	'\r':
+		case	'\f':
+			break;
+
+		case	'\n':
+			(*lines)++;
+			break;
+
+		default:
+			return i;
+		}
+	}
+	return length;
+}
+
+/*
+ *	escapeLength
+ *
+ *	Recognizes the escape sequence that starts with the '&' at 'text'.
+ *
+ *	RETURNS:
+ *		The length of the sequence, with the character it stands for in
+ *		*c, or 0 if it is not one of the escapes the parser knows.
+ */
+static int escapeLength(const char* text, char* c) {
+	if ((text[1] == 'l' || text[1] == 'L') &&
+		(text[2] == 't' || text[2] == 'T') &&
+		text[3] == ';'){
+		*c = '<';
+		return 4;
+	}
+	if ((text[1] == 'g' || text[1] == 'G') &&
+		(text[2] == 't' || text[2] == 'T') &&
+		text[3] == ';'){
+		*c = '>';
+		return 4;
+	}
+	if ((text[1] == 'a' || text[1] == 'A') &&
+		(text[2] == 'm' || text[2] == 'M') &&
+		(text[3] == 'p' || text[3] == 'P') &&
+		text[4] == ';'){
+		*c = '&';
+		return 5;
+	}
+	if ((text[1] == 'a' || text[1] == 'A') &&
+		(text[2] == 'p' || text[2] == 'P') &&
+		(text[3] == 'o' || text[3] == 'O') &&
+		(text[4] == 's' || text[4] == 'S') &&
+		text[5] == ';'){
+		*c = '\'';
+		return 6;
+	}
+	if ((text[1] == 'q' || text[1] == 'Q') &&
+		(text[2] == 'u' || text[2] == 'U') &&
+		(text[3] == 'o' || text[3] == 'O') &&
+		(text[4] == 't' || text[4] == 'T') &&
+		text[5] == ';'){
+		*c = '"';
+		return 6;
+	}
+	return 0;
+}
+/*
+ *	unescape
+ *
+ *	Replaces the escape sequences in text[start..end) in place.  They
+ *	must all be ones escapeLength recognizes.
+ *
+ *	RETURNS:
+ *		The new end of the text.
+ */
+static int unescape(char* text, int start, int end) {
+	int lines = 0;
+	int fill = start + scan(text + start, end - start, "&", 1, &lines);
+	int i = fill;
+	while (i < end) {
+		char c;
+		i += escapeLength(text + i, &c);
+		text[fill++] = c;
+		int run = scan(text + i, end - i, "&", 1, &lines);
+		memmove(text + fill, text + i, run);
+		fill += run;
+		i += run;
+	}
+	return fill;
+}
+
+static string unescaped(const char* text, int length) {
+	string s;
+	for (int i = 0; i < length;) {
+		char c = text[i];
+		if (c == '&')
+			i += escapeLength(text + i, &c);
+		else
+			i++;
+		s.push_back(c);
+	}
+	return s;
+}
+
+static bool isBlank(const char* text, int length) {
+	for (int i = 0; i < length; i++)
+		if (!isXMLSpace(text[i]))
+			return false;
+	return true;
+}
+
+static int skipSpace(const char* text, int length, int i) {
+	int lines = 0;
+	return i + scanSpace(text + i, length - i, &lines);
+}
+
+struct TagScan {
+	int			nameStart;
+	int			nameEnd;
+	int			end;				// just past the '>'
+	bool		empty;				// closed by "/>"
+};
+
+struct AttributeScan {
+	int			nameStart;
+	int			nameEnd;
+	int			valueStart;
+	int			valueEnd;			// before unescaping
+	int			location;
+};
+
+struct OpenTag {
+	int			entry;
+	int			nameStart;
+	int			nameLength;
+};
+/*
+ *	scanTag
+ *
+ *	Reads the open tag whose name starts at text[i] by the rules
+ *	Parser::consumeTag follows, without changing it.  Attribute values
+ *	are checked for escape sequences the parser does not know, but are
+ *	not unescaped.
+ *
+ *	RETURNS:
+ *		false if consumeTag would report an error in the tag.
+ */
+static bool scanTag(const char* text, int length, int i, TagScan* tag, vector<AttributeScan>* attributes) {
+	tag->nameStart = i;
+	i++;
+	while (i < length &&
+		   !isXMLSpace(text[i]) &&
+		   text[i] != '/' &&
+		   text[i] != '>')
+		i++;
+	if (i >= length)
+		return false;
+	tag->nameEnd = i;
+	for (;;) {
+		i = skipSpace(text, length, i);
+		if (text[i] == '>') {
+			tag->end = i + 1;
+			tag->empty = false;
+			return true;
+		}
+		if (text[i] == '/') {
+			i = skipSpace(text, length, i + 1);
+			if (i >= length || text[i] != '>')
+				return false;
+			tag->end = i + 1;
+			tag->empty = true;
+			return true;
+		}
+		AttributeScan a;
+		a.nameStart = i;
+		while (i < length &&
+			   !isXMLSpace(text[i]) &&
+			   text[i] != '/' &&
+			   text[i] != '>' &&
+			   text[i] != '=')
+			i++;
+		a.nameEnd = i;
+		i = skipSpace(text, length, i);
+		if (i >= length)
+			return false;
+		if (text[i] != '=') {
+			a.location = i;
+			a.valueStart = i;
+			a.valueEnd = i;
+		} else {
+			i++;
+			if (i >= length)
+				return false;
+			a.location = i;
+			char delim = 0;
+			if (text[i] == '"' || text[i] == '\'')
+				delim = text[i++];
+			a.valueStart = i;
+			for (;;) {
+				if (i >= length)
+					return false;
+				char c = text[i];
+				if (delim) {
+					if (c == delim)
+						break;
+				} else if (isXMLSpace(c) || c == '>' || (c == '/' && text[i + 1] == '>'))
+					break;
+				if (c == '&') {
+					int n = escapeLength(text + i, &c);
+					if (n == 0)
+						return false;
+					i += n;
+				} else
+					i++;
+			}
+			a.valueEnd = i;
+			if (delim)
+				i++;
+		}
+		if (attributes != null)
+			attributes->push_back(a);
+	}
+}
+/*
+ *	buildTape
+ *
+ *	The first stage of Document::loadLazily.  Follows the same rules as
+ *	Parser and DOMParser, finding runs of text, comments and the ends of
+ *	tags with the same SSE2 scanners, but only records where things are.
+ *
+ *	RETURNS:
+ *		true if the tape was built and the root element made.  false if
+ *		the parser would report an error, or make anything other than a
+ *		single root element at the top level.
+ */
+bool Document::buildTape(char* text, int length, bool exact) {
+	vector<OpenTag> open;
+	smallVector<AttributeScan, 8> attributes;
+	int lines = 0;
+	int top = -1;
+	int i = 0;
+	for (;;) {
+		int parent = open.size() ? open[open.size() - 1].entry : -1;
+		int textStart = i;
+		for (;;) {
+			i += scan(text + i, length - i, "<&", 2, &lines);
+			if (i >= length || text[i] == '<')
+				break;
+			char c;
+			int n = escapeLength(text + i, &c);
+			if (n == 0)
+				return false;
+			i += n;
+		}
+		if (i > textStart) {
+			bool blank = isBlank(text + textStart, i - textStart);
+			if (parent < 0) {
+				if (!blank)
+					return false;
+			} else if (exact || !blank)
+				addEntry(TEXT, textStart, i, parent);
+		}
+		if (i >= length)
+			break;
+		int tagStart = i;
+		i = skipSpace(text, length, i + 1);
+		if (i >= length)
+			return false;
+		if (text[i] == '!') {
+
+				// Only comments: CDATA and declarations are left to the parser
+
+			if (i + 2 >= length || text[i + 1] != '-' || text[i + 2] != '-')
+				return false;
+			i += 3;
+			int commentStart = i;
+			for (;;) {
+				i += scan(text + i, length - i, "-", 1, &lines);
+				if (i + 2 >= length)
+					return false;
+				if (text[i + 1] == '-' && text[i + 2] == '>')
+					break;
+				i++;
+			}
+			if (exact) {
+				if (parent < 0)
+					return false;
+				addEntry(COMMENT, commentStart, i, parent);
+			}
+			i += 3;
+		} else if (text[i] == '/') {
+			if (parent < 0)
+				return false;
+			i = skipSpace(text, length, i + 1);
+			int nameStart = i;
+			while (i < length && text[i] != '>' && !isXMLSpace(text[i]))
+				i++;
+			if (i >= length)
+				return false;
+			const OpenTag& o = open[open.size() - 1];
+			if (i != nameStart &&
+				(i - nameStart != o.nameLength ||
+				 memcmp(text + nameStart, text + o.nameStart, o.nameLength) != 0))
+				return false;
+			const char* close = (const char*)memchr(text + i, '>', length - i);
+			if (close == null)
+				return false;
+			i = int(close - text) + 1;
+			_tape[parent].next = _tape.size();
+			open.pop_back();
+		} else {
+			TagScan tag;
+			attributes.clear();
+			if (!scanTag(text, length, i, &tag, &attributes))
+				return false;
+			if (parent < 0) {
+				if (top >= 0)
+					return false;
+				top = _tape.size();
+			}
+			if (!tag.empty) {
+				OpenTag& o = open.emplace_back();
+				o.entry = _tape.size();
+				o.nameStart = tag.nameStart;
+				o.nameLength = tag.nameEnd - tag.nameStart;
+			}
+			addEntry(ELEMENT, tagStart, tag.end, parent);
+			for (int j = 0; j < attributes.size(); j++) {
+				const AttributeScan& a = attributes[j];
+				if (a.nameEnd - a.nameStart == 2 && memcmp(text + a.nameStart, "id", 2) == 0) {
+					addTapeId(text + a.valueStart, a.valueEnd - a.valueStart);
+					break;
+				}
+			}
+			i = tag.end;
+		}
+	}
+
+		// Elements still open at the end of the text close there, as they do in the parser
+
+	while (open.size())
+		_tape[open.pop_back().entry].next = _tape.size();
+	if (top < 0)
+		return false;
+	_source = text;
+	_sourceLength = length;
+	_root = makeNode(top, null);
+	indexId(_root);
+	return true;
+}
+
+void Document::addEntry(ElementKind kind, int start, int end, int parent) {
+	TapeEntry& t = _tape.emplace_back();
+	t.start = start;
+	t.end = end;
+	t.next = _tape.size();
+	t.parent = parent;
+	t.kind = kind;
+	t.sameId = -1;
+	t.node = null;
+}
+/*
+ *	addTapeId
+ *
+ *	Records the id of the element just added to the tape, so findOnTape
+ *	goes straight to the elements that have it.  The value is still
+ *	escaped in the text, so one with escapes is copied.
+ */
+void Document::addTapeId(const char* value, int length) {
+	int i = _tape.size() - 1;
+	string key;
+	if (memchr(value, '&', length) != null) {
+		key = unescaped(value, length);
+		value = key.c_str();
+		length = key.size();
+	}
+	if (!_tapeIds.insert(value, length, i)) {
+		int* last = _tapeIds.get(value, length);
+		_tape[i].sameId = *last;
+		*last = i;
+	}
+}
+/*
+ *	makeNode
+ *
+ *	The second stage: makes the node for tape entry 'i'.  An element
+ *	gets its tag and attributes, and keeps its tape entry if it has
+ *	children to be made later.  Text is unescaped in place, which is
+ *	why nothing is made twice.
+ */
+Element* Document::makeNode(int i, Element* parent) {
+	TapeEntry& t = _tape[i];
+	Element* e;
+	if (t.kind == ELEMENT) {
+		TagScan tag;
+		smallVector<AttributeScan, 8> attributes;
+		scanTag(_source, _sourceLength, skipSpace(_source, _sourceLength, t.start + 1), &tag, &attributes);
+		e = newElement(Symbol(_source + tag.nameStart, tag.nameEnd - tag.nameStart), t.start);
+
+			// The parser hands attributes over last first
+
+		for (int j = attributes.size() - 1; j >= 0; j--) {
+			const AttributeScan& a = attributes[j];
+			int valueEnd = unescape(_source, a.valueStart, a.valueEnd);
+			stringSlice value(_source + a.valueStart, valueEnd - a.valueStart);
+			e->setValue(newAttribute(Symbol(_source + a.nameStart, a.nameEnd - a.nameStart), value, a.location));
+		}
+		if (t.next > i + 1)
+			e->_tape = i;
+	} else {
+		int end = t.end;
+		if (t.kind == TEXT)
+			end = unescape(_source, t.start, t.end);
+		e = newElement(stringSlice(_source + t.start, end - t.start), t.start, t.kind);
+	}
+	e->parent = parent;
+	t.node = e;
+	return e;
+}
+
+void Document::expand(Element* e) {
+	int i = e->_tape;
+	e->_tape = -1;
+	bool indexed = contains(e);
+	Element* last = null;
+	for (int j = i + 1; j < _tape[i].next; j = _tape[j].next) {
+		Element* c = makeNode(j, e);
+		if (indexed)
+			indexId(c);
+		if (last != null)
+			last->sibling = c;
+		else
+			e->child = c;
+		last = c;
+	}
+}
+/*
+ *	materialize
+ *
+ *	RETURNS:
+ *		The node for tape entry 'i', made along with its ancestors and
+ *		their siblings if it was not made before.
+ */
+Element* Document::materialize(int i) {
+	if (_tape[i].node == null)
+		materialize(_tape[i].parent)->firstChild();
+	return _tape[i].node;
+}
+/*
+ *	findOnTape
+ *
+ *	getValue for the elements of a lazily loaded document that have not
+ *	been made.  The elements buildTape saw with the id are chained from
+ *	the last back to the first, and the first of them not yet made is
+ *	made, and so indexed, unless it was under an element that has since
+ *	been extracted.
+ */
+Element* Document::findOnTape(const string& id) {
+	int* last = _tapeIds.find(id);
+	if (last == null)
+		return null;
+	int found = -1;
+	for (int i = *last; i >= 0; i = _tape[i].sameId) {
+		const TapeEntry& t = _tape[i];
+		if (t.node != null)
+			continue;
+		int made = t.parent;
+		while (_tape[made].node == null)
+			made = _tape[made].parent;
+		if (contains(_tape[made].node))
+			found = i;
+	}
+	if (found < 0)
+		return null;
+	return materialize(found);
+}
 
 Parser::Parser(script::MessageLog* messageLog) {
 	lineCount = 0;
@@ -539,9 +1376,13 @@ Parser::Parser(script::MessageLog* messageLog) {
 	_consumedContents = false;
 	_noContents = false;
 	_allowContents = false;
-	_fillPoint = null;
+	_text = &_buffer[0];
+	_length = 0;
+	_fillPoint = 0;
 	_cursor = 0;
-	_inlineTextPoint = null;
+	_inlineTextPoint = 0;
+	_stream = null;
+	_base = 0;
 	_freeAttribs = null;
 	_processContent = true;
 	_messageLog = messageLog;
@@ -568,7 +1409,27 @@ bool Parser::matchAttribute(int index,
 
 void Parser::open(const string& text) {
 	_parseError = false;
+	_stream = null;
+	_base = 0;
 	_buffer = text;
+	useBuffer();
+}
+/*
+ *	open
+ *
+ *	Parses the 'length' bytes at 'text' where they are, without copying
+ *	them.  Escape sequences are replaced in place, so when parse returns
+ *	every saxString the callbacks were passed still holds its unescaped
+ *	text, for as long as 'text' lasts.  The byte at text[length] must
+ *	be a null.
+ */
+void Parser::open(char* text, int length) {
+	_parseError = false;
+	_stream = null;
+	_base = 0;
+	_buffer.clear();
+	_text = text;
+	_length = length;
 }
 
 void Parser::close() {
@@ -590,32 +1451,51 @@ bool Parser::parse() {
 	x.text = null;
 	x.length = 0;
 	rootTag = true;
+	_openTags.clear();
 	consumeText(x);
 	reportInlineText();
 	return !_parseError;
 }
+/*
+ *	parse
+ *
+ *	Parses the text read from 'stream' without reading all of it first.
+ *	Only a window of the text is held in memory: the window is refilled
+ *	a chunk at a time as the parser reaches its end, and between tokens
+ *	the text already consumed is dropped.  The window need only be large
+ *	enough for the longest single tag, comment or run of text, plus a
+ *	chunk.  Locations are offsets into the whole stream.
+ *
+ *	The saxStrings passed to a callback stay valid until the callback
+ *	returns, or until it calls parseContents or skipContents.
+ */
+bool Parser::parse(FILE* stream) {
+	_stream = stream;
+	_base = 0;
+	_buffer.clear();
+	useBuffer();
+	parse();
+	_stream = null;
+	_buffer.clear();
+	useBuffer();
+	return !_parseError;
+}
 
 bool Parser::load(const string& filename) {
 	FILE* fp = fileSystem::openTextFile(filename);
 	if (fp == null)
 		return false;
-	string text;
-	if (!fileSystem::readAll(fp, &text)) {
-		fclose(fp);
-		return false;
-	}
-	open(text);
+	parse(fp);
 	fclose(fp);
-	parse();
 	close();
 	return !_parseError;
 }
 
 script::fileOffset_t Parser::textLocation(const saxString &s) {
 	if (s.text) {
-		unsigned x = s.text - _buffer.c_str();
-		if (x < (unsigned)_buffer.size())
-			return x;
+		unsigned x = s.text - _text;
+		if (x < (unsigned)_length)
+			return _base + x;
 	}
 	return script::FILE_OFFSET_UNDEFINED;
 }
@@ -666,136 +1546,212 @@ bool Parser::anyTag(const saxString& text) {
 
 void Parser::anyCloseTag() {
 }
+/*
+ *	fill
+ *
+ *	Reads from the stream until the character 'lookahead' places past
+ *	the cursor is in the window, or the stream ends.  Everything in the
+ *	window keeps its index, but reading may move the window in memory.
+ *	The tag name and the pending attributes are the only saxStrings
+ *	held across a read, so they are moved along with it.
+ *
+ *	RETURNS:
+ *		true - if the character at _cursor + lookahead is in the window.
+ *		false - the text ends before it.
+ */
+bool Parser::fill(int lookahead) {
+	if (_stream == null)
+		return false;
+	const char* oldText = _text;
+	int oldSize = _length;
+	while (_cursor + lookahead >= _length) {
+		int size = _length;
+		char* cp = _buffer.buffer_(size + STREAM_CHUNK) + size;
+		int n = fread(cp, 1, STREAM_CHUNK, _stream);
+		_buffer.resize(size + n);
+		useBuffer();
+		if (n == 0) {
+			if (ferror(_stream))
+				_parseError = true;
+			_stream = null;
+			break;
+		}
+	}
+	const char* text = _text;
+	if (text != oldText) {
+		unsigned x = tag.text - oldText;
+		if (tag.text != null && x <= (unsigned)oldSize)
+			tag.text = (char*)text + x;
+		for (XMLParserAttributeList* a = unknownAttributes; a != null; a = a->next) {
+			a->name.text = (char*)text + (a->name.text - oldText);
+			a->value.text = (char*)text + (a->value.text - oldText);
+		}
+	}
+	return _cursor + lookahead < _length;
+}
+/*
+ *	slide
+ *
+ *	Called between tokens, when nothing before the cursor is needed any
+ *	longer.  Once a chunk or more of the window has been consumed, the
+ *	unread text is moved down to the front of it.
+ */
+void Parser::slide() {
+	if (_stream != null && _cursor >= STREAM_CHUNK) {
+		int unread = _length - _cursor;
+		memmove(&_text[0], &_text[_cursor], unread);
+		_buffer.resize(unread);
+		useBuffer();
+		_base += _cursor;
+		_cursor = 0;
+	}
+}
+
+void Parser::useBuffer() {
+	_text = &_buffer[0];
+	_length = _buffer.size();
+}
+
+saxString Parser::bufferText(int start, int end) {
+	saxString s;
+	s.text = &_text[start];
+	s.length = end - start;
+	return s;
+}
 
+void Parser::tagError(ErrorCodes code, int tagStart) {
+	_parseError = true;
+	errorText(code, bufferText(tagStart, _cursor), tagLocation);
+}
+/*
+ *	consumeText
+ *
+ *	The enclosing tag name is copied to _openTags, since the window may
+ *	slide past it before its close tag is reached.
+ */
 void Parser::consumeText(const saxString& enclosingTag) {
-	_fillPoint = &_buffer[_cursor];
+	int tagOffset = _openTags.size();
+	if (enclosingTag.length)
+		_openTags.append(enclosingTag.text, enclosingTag.length);
+	_fillPoint = _cursor;
 	_inlineTextPoint = _fillPoint;
-	saxString tag = enclosingTag;
+	saxString tag;
+	tag.length = enclosingTag.length;
 	while (collectText('<')) {
 		reportInlineText();
+		tag.text = &_openTags[tagOffset];
 		bool b = consumeTag(tag);
-		_fillPoint = &_buffer[_cursor];
+		slide();
+		_fillPoint = _cursor;
 		_inlineTextPoint = _fillPoint;
-		if (!b)
+		if (!b) {
+			_openTags.resize(tagOffset);
 			return;
+		}
 	}
 	reportInlineText();
+	_openTags.resize(tagOffset);
 }
 
 bool Parser::consumeTag(const saxString& enclosingTag) {
-	saxString wholeTag;
-	wholeTag.text = &_buffer[_cursor];
 	int tagStart = _cursor;
-	tagLocation = (script::fileOffset_t)_cursor;
+	tagLocation = _base + _cursor;
 	_cursor++;
 	skipWhiteSpace();
-	if (_cursor >= _buffer.size()) {
-		_parseError = true;
-		wholeTag.length = &_buffer[_cursor] - wholeTag.text;
-		errorText(XEC_UNTERMINATED, wholeTag, tagLocation);
+	if (!more()) {
+		tagError(XEC_UNTERMINATED, tagStart);
 		return true;
 	}
 
 		// Special tags, comments and cdata
 
-	if (_buffer[_cursor] == '!'){
-		if (_cursor + 2 < _buffer.size() &&
-			_buffer[_cursor + 1] == '-' &&
-			_buffer[_cursor + 2] == '-'){
+	if (_text[_cursor] == '!'){
+		more(7);
+		if (_cursor + 2 < _length &&
+			_text[_cursor + 1] == '-' &&
+			_text[_cursor + 2] == '-'){
 			_cursor += 3;
 			skipComment();
 			return true;
 		}
-		if (_cursor + 7 < _buffer.size() &&
-			_buffer[_cursor + 1] == '[' &&
-			(_buffer[_cursor + 2] == 'c' || _buffer[_cursor + 2] == 'C') &&
-			(_buffer[_cursor + 3] == 'd' || _buffer[_cursor + 3] == 'D') &&
-			(_buffer[_cursor + 4] == 'a' || _buffer[_cursor + 4] == 'A') &&
-			(_buffer[_cursor + 5] == 't' || _buffer[_cursor + 5] == 'T') &&
-			(_buffer[_cursor + 6] == 'a' || _buffer[_cursor + 6] == 'A') &&
-			_buffer[_cursor + 7] == ']'){
+		if (_cursor + 7 < _length &&
+			_text[_cursor + 1] == '[' &&
+			(_text[_cursor + 2] == 'c' || _text[_cursor + 2] == 'C') &&
+			(_text[_cursor + 3] == 'd' || _text[_cursor + 3] == 'D') &&
+			(_text[_cursor + 4] == 'a' || _text[_cursor + 4] == 'A') &&
+			(_text[_cursor + 5] == 't' || _text[_cursor + 5] == 'T') &&
+			(_text[_cursor + 6] == 'a' || _text[_cursor + 6] == 'A') &&
+			_text[_cursor + 7] == '['){
 			_cursor += 8;
 			int cdataStart = _cursor;
-			saxString sx;
-			sx.text = &_buffer[_cursor];
-			while (_cursor + 2 < _buffer.size()){
-				if (_buffer[_cursor] == ']' &&
-				    _buffer[_cursor + 1] == ']' &&
-				    _buffer[_cursor + 2] == '>'){
-					sx.length = _cursor - cdataStart;
+			while (more(2)){
+				_cursor += scan(&_text[_cursor], _length - _cursor, "]", 1, &lineCount);
+				if (!more(2))
+					break;
+				if (_text[_cursor] != ']')
+					continue;				// the scan ran off the end of the window
+				if (_text[_cursor + 1] == ']' &&
+				    _text[_cursor + 2] == '>'){
 					if (_processContent)
-						inlineText(sx, tagLocation);
+						inlineText(bufferText(cdataStart, _cursor), tagLocation);
 					_cursor += 3;
 					return true;
 				}
-				if (_buffer[_cursor] == '\n')
-					lineCount++;
 				_cursor++;
 			}
-			_parseError = true;
-			wholeTag.length = &_buffer[_cursor] - wholeTag.text;
-			errorText(XEC_UNTERMINATED, wholeTag, tagLocation);
+			tagError(XEC_UNTERMINATED, tagStart);
 			return true;
 		}					
 	}
-	if (_buffer[_cursor] == '/'){
+	if (_text[_cursor] == '/'){
 		_cursor++;
 		skipWhiteSpace();
 		int tagName = _cursor;
-		while (_cursor < _buffer.size() && 
-			   _buffer[_cursor] != '>' &&
-			   !isXMLSpace(_buffer[_cursor]))
+		while (more() && 
+			   _text[_cursor] != '>' &&
+			   !isXMLSpace(_text[_cursor]))
 			_cursor++;
-		if (_cursor >= _buffer.size()){
-			_parseError = true;
-			wholeTag.length = &_buffer[_cursor] - wholeTag.text;
-			errorText(XEC_UNTERMINATED, wholeTag, tagLocation);
+		if (!more()){
+			tagError(XEC_UNTERMINATED, tagStart);
 			return true;
 		}
 		if (_cursor != tagName){
 			if (_cursor - tagName != enclosingTag.length ||
-				memcmp(&_buffer[tagName], enclosingTag.text, enclosingTag.length) != 0){
-				_parseError = true;
-				wholeTag.length = &_buffer[_cursor] - wholeTag.text;
-				errorText(XEC_MISMATCH, wholeTag, tagLocation);
+				memcmp(&_text[tagName], enclosingTag.text, enclosingTag.length) != 0){
+				tagError(XEC_MISMATCH, tagStart);
 
 					// Skip to the end of tag.
 
-				while (_cursor < _buffer.size() &&
-					   _buffer[_cursor] != '>')
+				while (more() &&
+					   _text[_cursor] != '>')
 					   _cursor++;
-				if (_cursor < _buffer.size())
+				if (more())
 					_cursor++;
 				return true;
 			}
 		}
-		while (_cursor < _buffer.size() &&
-			   _buffer[_cursor] != '>')
+		while (more() &&
+			   _text[_cursor] != '>')
 			   _cursor++;
-		if (_cursor >= _buffer.size()){
-			_parseError = true;
-			wholeTag.length = &_buffer[_cursor] - wholeTag.text;
-			errorText(XEC_UNTERMINATED, wholeTag, tagLocation);
+		if (!more()){
+			tagError(XEC_UNTERMINATED, tagStart);
 			return true;
 		}
 		_cursor++;
 		return false;
 	}
-	tag.text = &_buffer[_cursor];
 	int tagName = _cursor;
 	_cursor++;
-	while (_cursor < _buffer.size() &&
-		   !isXMLSpace(_buffer[_cursor]) &&
-		   _buffer[_cursor] != '/' &&
-		   _buffer[_cursor] != '>')
+	while (more() &&
+		   !isXMLSpace(_text[_cursor]) &&
+		   _text[_cursor] != '/' &&
+		   _text[_cursor] != '>')
 		_cursor++;
-	if (_cursor >= _buffer.size()){
-		_parseError = true;
-		wholeTag.length = &_buffer[_cursor] - wholeTag.text;
-		errorText(XEC_UNTERMINATED, wholeTag, tagLocation);
+	if (!more()){
+		tagError(XEC_UNTERMINATED, tagStart);
 		return true;
 	}
-	tag.length = _cursor - tagName;
+	tag = bufferText(tagName, _cursor);
 	int matchingElement;
 	if (_processContent)
 		matchingElement = matchTag(tag);
@@ -806,7 +1762,7 @@ bool Parser::consumeTag(const saxString& enclosingTag) {
 	ErrorCodes errorCause = XEC_UNTERMINATED;
 	for (;;){
 		skipWhiteSpace();
-		if (_buffer[_cursor] == '>'){
+		if (_text[_cursor] == '>'){
 			_cursor++;
 			_consumedContents = false;
 			_noContents = false;
@@ -814,7 +1770,7 @@ bool Parser::consumeTag(const saxString& enclosingTag) {
 			if (_processContent) {
 				if (matchingElement >= 0){
 					if (!matchedTag(matchingElement)) {
-						errorText(XEC_EXPECTED_ATTRIBUTE, wholeTag, tagLocation);
+						errorText(XEC_EXPECTED_ATTRIBUTE, bufferText(tagStart, _cursor), tagLocation);
 						_parseError = true;
 					}
 				} else if (!anyTag(tag))
@@ -828,12 +1784,12 @@ bool Parser::consumeTag(const saxString& enclosingTag) {
 			resetAttributes();
 			return true;
 		}
-		if (_buffer[_cursor] == '/'){
+		if (_text[_cursor] == '/'){
 			_cursor++;
 			skipWhiteSpace();
-			if (_cursor >= _buffer.size())
+			if (!more())
 				break;
-			if (_buffer[_cursor] != '>'){
+			if (_text[_cursor] != '>'){
 				errorCause = XEC_EXPECT_CLOSE;
 				break;
 			}
@@ -842,7 +1798,7 @@ bool Parser::consumeTag(const saxString& enclosingTag) {
 			if (_processContent) {
 				if (matchingElement >= 0){
 					if (!matchedTag(matchingElement)) {
-						errorText(XEC_EXPECTED_ATTRIBUTE, wholeTag, tagLocation);
+						errorText(XEC_EXPECTED_ATTRIBUTE, bufferText(tagStart, _cursor), tagLocation);
 						_parseError = true;
 					}
 				} else {
@@ -855,47 +1811,40 @@ bool Parser::consumeTag(const saxString& enclosingTag) {
 			return true;
 		}
 		attribute = getAttribute();
-		attribute->name.text = &_buffer[_cursor];
 		int attrStart = _cursor;
-		while (_cursor < _buffer.size() && 
-			   !isXMLSpace(_buffer[_cursor]) &&
-			   _buffer[_cursor] != '/' &&
-			   _buffer[_cursor] != '>' &&
-			   _buffer[_cursor] != '=')
+		while (more() && 
+			   !isXMLSpace(_text[_cursor]) &&
+			   _text[_cursor] != '/' &&
+			   _text[_cursor] != '>' &&
+			   _text[_cursor] != '=')
 			_cursor++;
-		attribute->name.length = _cursor - attrStart;
+		int attrEnd = _cursor;
 		skipWhiteSpace();
-		if (_cursor >= _buffer.size())
+		if (!more())
 			break;
-		if (_buffer[_cursor] != '='){
-			attribute->location = (script::fileOffset_t)_cursor;
-			attribute->value.text = &_buffer[_cursor];
-			attribute->value.length = 0;
+		if (_text[_cursor] != '='){
+			attribute->location = _base + _cursor;
+			attribute->value = bufferText(_cursor, _cursor);
 		} else {
 			_cursor++;
-			if (_cursor >= _buffer.size())
+			if (!more())
 				break;
-			attribute->location = (script::fileOffset_t)_cursor;
-			attribute->value.text = &_buffer[_cursor];
+			attribute->location = _base + _cursor;
 			int valueStart = _cursor;
-			_fillPoint = attribute->value.text;
-			if (_buffer[_cursor] == '"' || _buffer[_cursor] == '\''){
-				char delim = _buffer[_cursor];
+			_fillPoint = valueStart;
+			if (_text[_cursor] == '"' || _text[_cursor] == '\''){
+				char delim = _text[_cursor];
 				_cursor++;
-				if (collectText(delim)){
-					char* xp = _fillPoint;
-					attribute->value.length = xp - attribute->value.text;
-				} else
+				if (!collectText(delim))
 					break;
 				_cursor++;
 			} else {
-				if (collectText('>')){
-					char* xp = _fillPoint;
-					attribute->value.length = xp - attribute->value.text;
-				} else
+				if (!collectText('>'))
 					break;
 			}
+			attribute->value = bufferText(valueStart, _fillPoint);
 		}
+		attribute->name = bufferText(attrStart, attrEnd);
 		if (_processContent) {
 			defineAttribute(matchingElement, attribute);
 			attribute = null;
@@ -904,62 +1853,67 @@ bool Parser::consumeTag(const saxString& enclosingTag) {
 	if (attribute != null)
 		freeAttribute(attribute);
 	resetAttributes();
-	_parseError = true;
-	wholeTag.length = &_buffer[_cursor] - wholeTag.text;
-	errorText(errorCause, wholeTag, tagLocation);
+	tagError(errorCause, tagStart);
 	return true;
 }
 
 void Parser::reportInlineText() {
 	if (_inlineTextPoint < _fillPoint) {
-		saxString sx;
-		sx.text = _inlineTextPoint;
-		sx.length = int(_fillPoint - _inlineTextPoint);
 		if (_processContent)
-			inlineText(sx, (script::fileOffset_t)(_inlineTextPoint - &_buffer[0]));
+			inlineText(bufferText(_inlineTextPoint, _fillPoint), _base + _inlineTextPoint);
 		_inlineTextPoint = _fillPoint;
 	}
 }
 
 void Parser::skipWhiteSpace() {
-	for (; _cursor < _buffer.size(); _cursor++) {
-		switch (_buffer[_cursor]) {
-		case	' ':
-		case	'\t':
-		case	'\r':
-		case	'\f':
-			break;
-
-		case	'\n':
-			lineCount++;
-			break;
-
-		default:
+	while (more()) {
+		_cursor += scanSpace(&_text[_cursor], _length - _cursor, &lineCount);
+		if (_cursor < _length)
 			return;
-		}
 	}
 }
-
+/*
+ *	collectText
+ *
+ *	Runs of ordinary text are found by scan and moved down to the fill
+ *	point whole.  Only the byte that stopped the scan is looked at here.
+ */
 bool Parser::collectText(char delim) {
-	while (_cursor < _buffer.size()){
+	char stops[MAX_STOPS];
+	int count = 0;
+	stops[count++] = delim;
+	stops[count++] = '&';
+	if (delim == '>') {
+		stops[count++] = '/';
+		stops[count++] = ' ';
+		stops[count++] = '\t';
+		stops[count++] = '\r';
+		stops[count++] = '\n';
+	}
+	while (more()){
+		int run = scan(&_text[_cursor], _length - _cursor, stops, count, &lineCount);
+		if (run) {
+			if (_fillPoint != _cursor)
+				memmove(&_text[_fillPoint], &_text[_cursor], run);
+			_fillPoint += run;
+			_cursor += run;
+			if (!more())
+				break;
+		}
 		if (delim == '>'){
-			if (isXMLSpace(_buffer[_cursor]))
+			if (isXMLSpace(_text[_cursor]))
 				return true;
-			if (_buffer[_cursor] == '/' &&
-				_cursor + 1 < _buffer.size() &&
-				_buffer[_cursor + 1] == '>')
+			if (_text[_cursor] == '/' &&
+				more(1) &&
+				_text[_cursor + 1] == '>')
 				return true;
 		}
-		if (_buffer[_cursor] == delim)
+		if (_text[_cursor] == delim)
 			return true;
-		else if (_buffer[_cursor] == '&')
+		else if (_text[_cursor] == '&')
 			consumeEscapeSequence();
-		else {
-			*_fillPoint++ = _buffer[_cursor];
-			if (_buffer[_cursor] == '\n')
-				lineCount++;
-			_cursor++;
-		}
+		else
+			_text[_fillPoint++] = _text[_cursor++];
 	}
 	return false;
 }
@@ -983,20 +1937,22 @@ void Parser::resetAttributes() {
 }
 
 void Parser::skipComment() {
-	saxString sx;
-	script::fileOffset_t commentLoc = (script::fileOffset_t)_cursor;
-	sx.text = &_buffer[_cursor];
-	while (_cursor + 2 < _buffer.size() &&
-		   (_buffer[_cursor] != '-' ||
-		    _buffer[_cursor + 1] != '-' ||
-		    _buffer[_cursor + 2] != '>')){
-		if (_buffer[_cursor] == '\n')
-			lineCount++;
+	int commentStart = _cursor;
+	script::fileOffset_t commentLoc = _base + _cursor;
+	while (more(2)){
+		_cursor += scan(&_text[_cursor], _length - _cursor, "-", 1, &lineCount);
+		if (!more(2))
+			break;
+		if (_text[_cursor] != '-')
+			continue;					// the scan ran off the end of the window
+		if (_text[_cursor + 1] == '-' &&
+			_text[_cursor + 2] == '>')
+			break;
 		_cursor++;
 	}
-	sx.length = &_buffer[_cursor] - sx.text;
-	if (_cursor + 2 >= _buffer.size()){
-		_cursor = _buffer.size();
+	saxString sx = bufferText(commentStart, _cursor);
+	if (_cursor + 2 >= _length){
+		_cursor = _length;
 		errorText(XEC_COMMENT, sx, commentLoc);
 		_parseError = true;
 	} else {
@@ -1007,55 +1963,19 @@ void Parser::skipComment() {
 }
 
 void Parser::consumeEscapeSequence() {
-	if ((_buffer[_cursor + 1] == 'l' || _buffer[_cursor + 1] == 'L') &&
-		(_buffer[_cursor + 2] == 't' || _buffer[_cursor + 2] == 'T') &&
-		_buffer[_cursor + 3] == ';'){
-		*_fillPoint++ = '<';
-		_cursor += 4;
-		return;
-	}
-	if ((_buffer[_cursor + 1] == 'g' || _buffer[_cursor + 1] == 'G') &&
-		(_buffer[_cursor + 2] == 't' || _buffer[_cursor + 2] == 'T') &&
-		_buffer[_cursor + 3] == ';'){
-		*_fillPoint++ = '>';
-		_cursor += 4;
-		return;
-	}
-	if ((_buffer[_cursor + 1] == 'a' || _buffer[_cursor + 1] == 'A') &&
-		(_buffer[_cursor + 2] == 'm' || _buffer[_cursor + 2] == 'M') &&
-		(_buffer[_cursor + 3] == 'p' || _buffer[_cursor + 3] == 'P') &&
-		_buffer[_cursor + 4] == ';'){
-		*_fillPoint++ = '&';
-		_cursor += 5;
-		return;
-	}
-	if ((_buffer[_cursor + 1] == 'a' || _buffer[_cursor + 1] == 'A') &&
-		(_buffer[_cursor + 2] == 'p' || _buffer[_cursor + 2] == 'P') &&
-		(_buffer[_cursor + 3] == 'o' || _buffer[_cursor + 3] == 'O') &&
-		(_buffer[_cursor + 4] == 's' || _buffer[_cursor + 4] == 'S') &&
-		_buffer[_cursor + 5] == ';'){
-		*_fillPoint++ = '\'';
-		_cursor += 6;
-		return;
-	}
-	if ((_buffer[_cursor + 1] == 'q' || _buffer[_cursor + 1] == 'Q') &&
-		(_buffer[_cursor + 2] == 'u' || _buffer[_cursor + 2] == 'U') &&
-		(_buffer[_cursor + 3] == 'o' || _buffer[_cursor + 3] == 'O') &&
-		(_buffer[_cursor + 4] == 't' || _buffer[_cursor + 4] == 'T') &&
-		_buffer[_cursor + 5] == ';'){
-		*_fillPoint++ = '"';
-		_cursor += 6;
+	more(5);
+	char c;
+	int n = escapeLength(&_text[_cursor], &c);
+	if (n) {
+		_text[_fillPoint++] = c;
+		_cursor += n;
 		return;
 	}
 
 	_parseError = true;
 
-	saxString sx;
-
-	sx.text = &_buffer[_cursor];
-	sx.length = 1;
-	errorText(XEC_ESCAPE, sx, (script::fileOffset_t)_cursor);
-	*_fillPoint++ = _buffer[_cursor++];
+	errorText(XEC_ESCAPE, bufferText(_cursor, _cursor + 1), _base + _cursor);
+	_text[_fillPoint++] = _text[_cursor++];
 }
 
 XMLParserAttributeList* Parser::getAttribute() {
@@ -1072,33 +1992,56 @@ void Parser::freeAttribute(XMLParserAttributeList* a) {
 	_freeAttribs = a;
 }
 
-string escape(const string& s) {
-	string output;
-	for (int i = 0; i < s.size(); i++) {
-		switch (s[i]){
-		case	'<':
-			output.append("&lt;");
-			break;
-
-		case	'>':
-			output.append("&gt;");
-			break;
+static const char xmlSpecials[] = "<>&'\"";
 
-		case	'&':
-			output.append("&amp;");
-			break;
-
-		case	'\'':
-			output.append("&apos;");
-			break;
-
-		case	'\"':
-			output.append("&quot;");
-			break;
+static const char* xmlEntity(char c) {
+	switch (c) {
+	case	'<':	return "&lt;";
+	case	'>':	return "&gt;";
+	case	'&':	return "&amp;";
+	case	'\'':	return "&apos;";
+	case	'\"':	return "&quot;";
+	default:		return null;
+	}
+}
+/*
+ *	escape
+ *
+ *	The text between special characters is found with
+ *	string::findFirstOf and copied in bulk, into an output
+ *	sized by a first pass over the specials.
+ */
+string escape(const string& s) {
+	const char* text = s.c_str();
+	int length = s.size();
+	int i = string::findFirstOf(text, length, xmlSpecials, sizeof xmlSpecials - 1);
+	if (i == string::npos)
+		return s;
+
+	int outputLength = length;
+	for (int j = i; j != string::npos; ) {
+		outputLength += strlen(xmlEntity(text[j])) - 1;
+		j++;
+		int k = string::findFirstOf(text + j, length - j, xmlSpecials, sizeof xmlSpecials - 1);
+		j = k == string::npos ? k : j + k;
+	}
 
-		default:
-			output.push_back(s[i]);
-		}
+	string output;
+	char* out = output.buffer_(outputLength);
+	memcpy(out, text, i);
+	out += i;
+	while (i < length) {
+		const char* entity = xmlEntity(text[i]);
+		int n = strlen(entity);
+		memcpy(out, entity, n);
+		out += n;
+		i++;
+		int clean = string::findFirstOf(text + i, length - i, xmlSpecials, sizeof xmlSpecials - 1);
+		if (clean == string::npos)
+			clean = length - i;
+		memcpy(out, text + i, clean);
+		out += clean;
+		i += clean;
 	}
 	return output;
 }
@@ -1121,53 +2064,9 @@ bool isXMLSpace(char c) {
 }
 
 double sax_to_double(const char* text, int length) {
-	bool neg = false;
-	if (text[0] == '-') {
-		neg = true;
-		text++;
-		length--;
-	}
-	double result = 0.0;
-	int i;
-	for (i = 0; i < length; i++){
-		if (text[i] == '.')
-			break;
-		result = result * 10 + (text[i] - '0');
-	}
-	if (i < length){
-		i++;
-		double divisor = 10.0f;
-		while (i < length){
-			if (text[i] == 'e' ||
-				text[i] == 'E')
-				break;
-			result += (text[i] - '0') / divisor;
-			divisor *= 10;
-			i++;
-		}
-		if (i < length){
-			i++;
-			int exponent = 0;
-			bool negative = false;
-			if (i < length){
-				if (text[i] == '-'){
-					negative = true;
-					i++;
-				} else if (text[i] == '+')
-					i++;
-				while (i < length){
-					exponent = exponent * 10 + (text[i] - '0');
-					i++;
-				}
-			}
-			if (negative)
-				exponent = -exponent;
-			result = result * pow(10.0, exponent);
-		}
-	}
-	if (neg)
-		result = -result;
-	return result;
+	double x;
+	number::parse(text, length, &x);
+	return x;
 }
 
 const char* errorCodeString(ErrorCodes ec) {
@@ -1,8 +1,12 @@
 #pragma once
 #include <ctype.h>
 #include <stdio.h>
+#include "arena.h"
+#include "dictionary.h"
 #include "script.h"
 #include "string.h"
+#include "symbol.h"
+#include "vector.h"
 
 namespace xml {
 
@@ -13,6 +17,16 @@ class Element;
 
 Document* load(const string& filename, bool exact);
 
+enum ElementKind {
+	ELEMENT,
+	TEXT,						// text is the text, no children
+	COMMENT,					// text is the text, no children
+	PROCESSING_INSTRUCTION,		// text is the PITarget and text
+	ERROR_TEXT,					// text is the bad text
+	ROOT,						// root node of a parse
+	DECLARATION,				// tag is the declaration tag (!DOCTYPE, etc.)
+};
+
 /*
 	The XML parser contained in this file is based on the XML Specification
 	described in W3C document REC-xml-19980210.  It is available at
@@ -40,16 +54,32 @@ Document* load(const string& filename, bool exact);
 	with this code.  In particular, adding code to this may be needed to recognize
 	certain forms properly.
  */
+/*
+ *	Document
+ *
+ *	A document owns all of its Elements and Attributes, which are
+ *	allocated from its arena, along with the text they refer to.  Text
+ *	and attribute values are slices: of the document's copy of the file
+ *	when it was loaded by name, which is unescaped in place by the
+ *	parser, or of copies made in the arena when it was read from a
+ *	stream.  Clearing or destroying the document releases the whole
+ *	tree at once.
+ */
 class Document {
 	friend DOMParser;
 public:
 	Document();
-
+	/*
+	 *	clear
+	 *
+	 *	Releases every Element and Attribute the document allocated, and
+	 *	all of its text.
+	 */
 	void clear();
 
 	Element* root() const { return _root; }
 
-	void set_root(Element* e) { _root = e; }
+	void set_root(Element* e);
 	/*
 	newRoot:		event (root: Element)
 	newChild:		event (parent: Element)
@@ -68,11 +98,77 @@ public:
 		this.parseError = pe
 	}
 	*/
+	/*
+	 *	getValue
+	 *
+	 *	Finds an element in the tree by its "id" attribute.  The
+	 *	document keeps an index of ids, built as it is parsed and kept up
+	 *	to date by Element::setValue, removeValue, append and extract, so
+	 *	this costs a hash lookup, not a walk of the tree.  If two
+	 *	elements have the same id, the first one indexed is found.
+	 *
+	 *	RETURNS:
+	 *		The element, or null if there is none with that id.
+	 */
 	Element* getValue(const string& id);
 
+	/*
+	 *	load
+	 *
+	 *	Reads the whole file into the arena and parses it there, so no
+	 *	text is copied after it is read.
+	 */
 	bool load(const string& filename, bool exact);
-
+	/*
+	 *	load
+	 *
+	 *	Parses 'stream' as it is read (see Parser::parse), copying the
+	 *	text the document keeps into the arena.
+	 */
 	void load(FILE* stream, bool exact);
+	/*
+	 *	loadLazily
+	 *
+	 *	Loads the file in two stages.  The first is one pass over the
+	 *	text that checks it and records a tape: an entry for each
+	 *	element, text run and comment, with the extent of each element.
+	 *	Only the root Element is made.  The children of an element, with
+	 *	their attributes and unescaped text, are made from the tape the
+	 *	first time Element::firstChild is called on it, and getValue
+	 *	searches the tape, making only the elements on the path to the
+	 *	one it finds.
+	 *
+	 *	Text that is not well formed, or that has CDATA, declarations or
+	 *	anything but white space and comments outside the root element,
+	 *	is loaded in full, as load does, so errors are reported the same
+	 *	way.
+	 */
+	bool loadLazily(const string& filename, bool exact);
+
+	Element* newElement(Symbol tag, script::fileOffset_t location, ElementKind kind = ELEMENT);
+	/*
+	 *	newElement
+	 *
+	 *	The element's text refers to 'text' in place: it must last as
+	 *	long as the element (see copy).
+	 */
+	Element* newElement(const stringSlice& text, script::fileOffset_t location, ElementKind kind);
+
+	Attribute* newAttribute(Symbol name, const stringSlice& value, script::fileOffset_t location);
+	/*
+	 *	copy
+	 *
+	 *	RETURNS:
+	 *		A copy of 'text' that lasts as long as the document.
+	 */
+	stringSlice copy(const stringSlice& text);
+	/*
+	 *	setValue
+	 *
+	 *	Sets attribute 'name' of 'e' to a copy of 'value', or removes the
+	 *	attribute if 'value' is null.
+	 */
+	void setValue(Element* e, Symbol name, const string* value, script::fileOffset_t location);
 	/*
 	save: (filename: string) boolean
 	{
@@ -195,31 +291,103 @@ public:
 bool		parseError() const { return _parseError; }
 
 private:
-	Element*	_root;
-	bool		_parseError;
-};
+	friend Element;
 
-enum ElementKind {
-	ELEMENT,
-	TEXT,						// tag is the text, no children
-	COMMENT,					// tag is the text, no children
-	PROCESSING_INSTRUCTION,		// tag is the PITarget and text
-	ERROR_TEXT,					// tag is the bad text
-	ROOT,						// root node of a parse
-	DECLARATION,				// tag is the declaration tag (!DOCTYPE, etc.)
+	struct TapeEntry {
+		int			start;			// ELEMENT: the '<', COMMENT: after the "<!--", TEXT: the text
+		int			end;			// ELEMENT: just past the open tag, otherwise the end of the text
+		int			next;			// tape index of the next sibling, past any children
+		int			parent;			// tape index of the enclosing element, -1 at the top
+		ElementKind	kind;
+		int			sameId;			// ELEMENT: tape index of the previous element with its id, or -1
+		Element*	node;			// once it has been made
+	};
+
+	char* readFile(const string& filename, int* length, FILE** stream);
+
+	bool loadStream(FILE* stream, bool exact);
+
+	bool buildTape(char* text, int length, bool exact);
+
+	void addEntry(ElementKind kind, int start, int end, int parent);
+
+	void addTapeId(const char* value, int length);
+
+	Element* makeNode(int i, Element* parent);
+
+	void expand(Element* e);
+
+	Element* materialize(int i);
+
+	Element* findOnTape(const string& id);
+
+	bool contains(Element* e);
+
+	void indexId(Element* e);
+
+	void indexTree(Element* e);
+
+	void unindexTree(Element* e);
+
+	void unindex(Element* e, const stringSlice& id);
+
+	void idChanged(Element* e, Symbol name, const stringSlice* oldValue);
+
+	Element*			_root;
+	bool				_parseError;
+	arena				_arena;
+	vector<TapeEntry>	_tape;			// empty unless loaded lazily
+	char*				_source;		// the text the tape describes
+	int					_sourceLength;
+	dictionary<Element*> _ids;			// id -> element, for the elements under the root
+	dictionary<int>		_tapeIds;		// id -> tape index of the last element with it
+	Symbol				_idName;
+	bool				_duplicateIds;	// some id was given to more than one element
 };
 
+/*
+ *	Element
+ *
+ *	Element tags and attribute names are interned Symbols, so a document
+ *	keeps one copy of each distinct name however many nodes use it.  The
+ *	content of text-like nodes (see ElementKind) is a slice in 'text'.
+ *	Elements are normally allocated by Document::newElement.
+ */
+
 class Element {
 public:
-	Element(const string& tag, script::fileOffset_t i);
+	Element(Symbol tag, script::fileOffset_t i, ElementKind kind = ELEMENT);
 
-	Element(const string& tag, script::fileOffset_t i, ElementKind kind);
+	Element(const stringSlice& text, script::fileOffset_t i, ElementKind kind);
 
 	Element* getById(const string& id);
-
-	string* getValue(const string& name);
-
-	void setValue(const string& name, const string* value, script::fileOffset_t location);
+	/*
+	 *	firstChild
+	 *
+	 *	The same as 'child', except that in a document loaded lazily it
+	 *	makes the element's children the first time it is called.  Code
+	 *	that may be handed such a document walks the tree with this.
+	 */
+	Element* firstChild();
+	/*
+	 *	getValue
+	 *
+	 *	The string form only looks 'name' up in the symbol table: a name
+	 *	that was never interned cannot be the name of any attribute.
+	 */
+	stringSlice* getValue(const string& name);
+
+	stringSlice* getValue(Symbol name);
+	/*
+	 *	setValue
+	 *
+	 *	Adds 'a' to the attributes, in place of any attribute with the
+	 *	same name.  Use Document::setValue to set an attribute to a
+	 *	string value.
+	 */
+	void setValue(Attribute* a);
+
+	void removeValue(Symbol name);
 	/*
 	getChild: public (tag: string) Element
 	{
@@ -334,17 +502,25 @@ public:
 	Element*				child;
 	Element*				sibling;
 	ElementKind				kind;
-	string					tag;
+	Symbol					tag;
+	stringSlice				text;
 	script::fileOffset_t	location;
 	Attribute*				attributes;
 
 private:
+	friend Document;
+
 	void init();
+
+	Element* findById(Symbol idName, const string& id);
+
+	Document*				_document;			// the document that made it, if any
+	int						_tape;				// tape entry, while the children are still to be made
 };
 
 class Attribute {
 public:
-	Attribute(const string& name, const string& value, script::fileOffset_t location) {
+	Attribute(Symbol name, const stringSlice& value, script::fileOffset_t location) {
 		this->next = null;
 		this->name = name;
 		this->value = value;
@@ -352,8 +528,8 @@ public:
 	}
 
 	Attribute*				next;
-	string					name;
-	string					value;
+	Symbol					name;
+	stringSlice				value;
 	script::fileOffset_t	location;
 };
 
@@ -394,14 +570,17 @@ struct saxString {
 		return string(text, length);
 	}
 
+	stringSlice slice() const {
+		return stringSlice(text, length);
+	}
+
 	double toDouble() const {
 		// turns out: strtod is really, really slow in VC
 		return sax_to_double(text, length);
 	}
 
 	int toInt() const {
-		string s(text, length);
-		return atoi(s.c_str());
+		return slice().toInt();
 	}
 
 	int hexInt() const {
@@ -450,10 +629,14 @@ public:
 
 	void open(const string& text);
 
+	void open(char* text, int length);
+
 	void close();
 
 	bool parse();
 
+	bool parse(FILE* stream);
+
 	bool load(const string& filename);
 
 	void disallowContents();
@@ -486,6 +669,22 @@ public:
 	XMLParserAttributeList*	unknownAttributes;
 	bool					rootTag;
 private:
+	static const int STREAM_CHUNK = 64 * 1024;
+
+	bool more(int lookahead = 0) {
+		return _cursor + lookahead < _length || fill(lookahead);
+	}
+
+	bool fill(int lookahead);
+
+	void slide();
+
+	void useBuffer();
+
+	saxString bufferText(int start, int end);
+
+	void tagError(ErrorCodes code, int tagStart);
+
 	void consumeText(const saxString& enclosingTag);
 
 	bool consumeTag(const saxString& enclosingTag);
@@ -513,10 +712,15 @@ private:
 	bool					_consumedContents;
 	bool					_noContents;
 	bool					_allowContents;
-	string					_buffer;
-	char*					_fillPoint;
+	char*					_text;				// the text being parsed: _buffer, or the caller's text
+	int						_length;
+	string					_buffer;			// copy of the text, or window onto the stream
+	int						_fillPoint;
 	int						_cursor;
-	char*					_inlineTextPoint;
+	int						_inlineTextPoint;
+	FILE*					_stream;			// null when parsing text in memory, or at end of stream
+	script::fileOffset_t	_base;				// stream offset of _buffer[0]
+	string					_openTags;			// names of the enclosing tags
 	XMLParserAttributeList* _freeAttribs;
 	bool					_processContent;
 	script::MessageLog*		_messageLog;
@@ -546,6 +750,14 @@ public:
 	void parse() { super::parse(); }
 
 	Document* parse(FILE* stream, bool e);
+	/*
+	 *	parse
+	 *
+	 *	Parses the 'length' bytes at 'text', followed by a null, in place
+	 *	(see Parser::open).  The document refers to the unescaped text,
+	 *	so 'text' must last as long as the document does.
+	 */
+	Document* parse(char* text, int length, bool e);
 
 	virtual void inlineText(const saxString& text, script::fileOffset_t location);
 
@@ -566,8 +778,11 @@ private:
 
 	Document* result();
 
+	stringSlice keep(const saxString& s);
+
 	Document*			xmlDoc;
 	bool				exact;
+	bool				inPlace;			// saxStrings last as long as the document
 	Element*			last;
 	Element*			context;
 };
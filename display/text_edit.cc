@@ -1909,11 +1909,12 @@ int TextLine::search(const string &key, int startOffset, Anchor *end) {
 	int endOffset = 1 + _length - key.size();
 	if (end->line() == this && end->_location > startOffset && end->_location < endOffset)
 		endOffset = end->_location;
-	for (int i = startOffset; i < endOffset; i++) {
-		if (memcmp(key.c_str(), _text + i, key.size()) == 0)
-			return location() + i;
-	}
-	return script::FILE_OFFSET_UNDEFINED;
+	if (startOffset >= endOffset)
+		return script::FILE_OFFSET_UNDEFINED;
+	int i = string::search(_text + startOffset, endOffset - startOffset + key.size() - 1, key.c_str(), key.size());
+	if (i == string::npos)
+		return script::FILE_OFFSET_UNDEFINED;
+	return location() + startOffset + i;
 }
 
 int TextLine::lineno() const {